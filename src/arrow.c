@@ -0,0 +1,447 @@
+#include "data.table.h"
+
+// Export of a data.table to the Arrow C Data Interface, https://arrow.apache.org/docs/format/CDataInterface.html
+// The columns fread returns as int, double and integer64 (including IDate, ITime and nanotime) are shared as they are:
+// the Arrow buffer is the R vector's data, kept from the garbage collector until the consumer releases the array. Only
+// a validity bitmap is added when the column has NA. Other columns (logical, character, factor, POSIXct, double Date)
+// have a different layout in Arrow, so they are copied to new 64-byte aligned buffers.
+
+// The two structs and flags are copied from the specification, as it intends, so that no Arrow headers are needed.
+#ifndef ARROW_C_DATA_INTERFACE
+#define ARROW_C_DATA_INTERFACE
+#define ARROW_FLAG_DICTIONARY_ORDERED 1
+#define ARROW_FLAG_NULLABLE 2
+#define ARROW_FLAG_MAP_KEYS_SORTED 4
+struct ArrowSchema {
+  const char *format;
+  const char *name;
+  const char *metadata;
+  int64_t flags;
+  int64_t n_children;
+  struct ArrowSchema **children;
+  struct ArrowSchema *dictionary;
+  void (*release)(struct ArrowSchema *);
+  void *private_data;
+};
+struct ArrowArray {
+  int64_t length;
+  int64_t null_count;
+  int64_t offset;
+  int64_t n_buffers;
+  int64_t n_children;
+  const void **buffers;
+  struct ArrowArray **children;
+  struct ArrowArray *dictionary;
+  void (*release)(struct ArrowArray *);
+  void *private_data;
+};
+#endif
+
+typedef struct {
+  const void *buffers[3];  // ArrowArray.buffers points here
+  void *blocks[3];         // what malloc returned for the buffers allocated by the export; NULL for those shared with R
+  SEXP keep;               // the R vector whose data is shared, preserved until release; R_NilValue when none
+} ArrayPrivate;
+
+static char *dupstr(const char *s) {
+  char *ans = malloc(strlen(s)+1);
+  if (ans) strcpy(ans, s);
+  return ans;
+}
+
+static void releaseSchema(struct ArrowSchema *s) {
+  for (int64_t i=0; i<s->n_children; i++) {
+    struct ArrowSchema *c = s->children[i];
+    if (!c) continue;  // an export which failed part way
+    if (c->release) c->release(c);
+    free(c);
+  }
+  free(s->children);
+  if (s->dictionary) {
+    if (s->dictionary->release) s->dictionary->release(s->dictionary);
+    free(s->dictionary);
+  }
+  free((char *)s->format);
+  free((char *)s->name);
+  s->release = NULL;
+}
+
+static void releaseArray(struct ArrowArray *a) {
+  // R_ReleaseObject() is R's API, so the consumer must release from R's main thread
+  for (int64_t i=0; i<a->n_children; i++) {
+    struct ArrowArray *c = a->children[i];
+    if (!c) continue;
+    if (c->release) c->release(c);
+    free(c);
+  }
+  free(a->children);
+  if (a->dictionary) {
+    if (a->dictionary->release) a->dictionary->release(a->dictionary);
+    free(a->dictionary);
+  }
+  ArrayPrivate *p = a->private_data;
+  if (p) {
+    for (int i=0; i<3; i++) free(p->blocks[i]);
+    if (p->keep!=R_NilValue) R_ReleaseObject(p->keep);
+    free(p);
+  }
+  a->release = NULL;
+}
+
+static bool initSchema(struct ArrowSchema *s, const char *format, const char *name, int64_t nChildren) {
+  *s = (struct ArrowSchema){ .flags=ARROW_FLAG_NULLABLE, .release=releaseSchema };
+  s->format = dupstr(format);
+  s->name = dupstr(name);
+  if (nChildren) {
+    s->children = calloc(nChildren, sizeof(struct ArrowSchema *));
+    if (!s->children) return false;
+    s->n_children = nChildren;  // after the allocation as release() frees n_children children
+  }
+  return s->format && s->name;
+}
+
+static bool initArray(struct ArrowArray *a, int64_t n, int nBuffers, int64_t nChildren) {
+  *a = (struct ArrowArray){ .length=n, .n_buffers=nBuffers, .release=releaseArray };
+  ArrayPrivate *p = calloc(1, sizeof(ArrayPrivate));
+  if (!p) return false;
+  p->keep = R_NilValue;
+  a->private_data = p;
+  a->buffers = p->buffers;
+  if (nChildren) {
+    a->children = calloc(nChildren, sizeof(struct ArrowArray *));
+    if (!a->children) return false;
+    a->n_children = nChildren;
+  }
+  return true;
+}
+
+static void *alloc64(struct ArrowArray *a, int i, size_t bytes) {
+  // buffer i of a, aligned to 64 bytes as Arrow recommends
+  ArrayPrivate *p = a->private_data;
+  char *b = malloc(bytes+63);
+  if (!b) return NULL;
+  p->blocks[i] = b;
+  p->buffers[i] = (void *)(((uintptr_t)b+63) & ~(uintptr_t)63);
+  return (void *)p->buffers[i];
+}
+
+static void share(struct ArrowArray *a, SEXP x, const void *data) {
+  // buffer 1 of a is the data of R vector x
+  ArrayPrivate *p = a->private_data;
+  R_PreserveObject(x);
+  p->keep = x;
+  p->buffers[1] = data;
+}
+
+// Clears the validity bit of row i in buffer 0, allocating it with all rows valid at the first null. Returns false when
+// that allocation fails.
+#define SETNULL(a, bits, i) {                                          \
+  if (!bits) {                                                         \
+    const size_t nb = ((size_t)(a)->length+7)/8;                       \
+    if (!(bits = alloc64(a, 0, nb))) return false;                     \
+    memset(bits, 0xFF, nb);                                            \
+  }                                                                    \
+  bits[(i)>>3] &= (uint8_t)~(1u<<((i)&7));                             \
+  (a)->null_count++;                                                   \
+}
+
+static bool exportStrings(SEXP x, struct ArrowSchema *s, struct ArrowArray *a, const char *name) {
+  // utf8, or large_utf8 with int64 offsets when the strings add up to more than int32 can address
+  const int64_t n = xlength(x);
+  const SEXP *xd = SEXPPTR_RO(x);
+  size_t total = 0;
+  for (int64_t i=0; i<n; i++) if (xd[i]!=NA_STRING) total += LENGTH(ENC2UTF8(xd[i]));
+  const bool large = total > INT32_MAX;
+  if (!initSchema(s, large ? "U" : "u", name, 0) || !initArray(a, n, 3, 0)) return false;
+  void *offsets = alloc64(a, 1, (n+1)*(large ? sizeof(int64_t) : sizeof(int32_t)));
+  char *data = alloc64(a, 2, total);
+  if (!offsets || !data) return false;
+  uint8_t *bits = NULL;
+  size_t off = 0;
+  for (int64_t i=0; i<n; i++) {
+    if (large) ((int64_t *)offsets)[i] = (int64_t)off; else ((int32_t *)offsets)[i] = (int32_t)off;
+    if (xd[i]==NA_STRING) { SETNULL(a, bits, i); continue; }
+    const SEXP s = ENC2UTF8(xd[i]);
+    memcpy(data+off, CHAR(s), LENGTH(s));
+    off += LENGTH(s);
+  }
+  if (large) ((int64_t *)offsets)[n] = (int64_t)off; else ((int32_t *)offsets)[n] = (int32_t)off;
+  return true;
+}
+
+static const char *columnFormat(SEXP x) {
+  // the Arrow format string of column x; NULL when the column can't be exported
+  switch(TYPEOF(x)) {
+  case LGLSXP :
+    return "b";
+  case INTSXP :
+    if (isFactor(x)) return TYPEOF(getAttrib(x, R_LevelsSymbol))==STRSXP ? "i" : NULL;
+    if (INHERITS(x, char_Date)) return "tdD";  // IDate
+    if (INHERITS(x, char_ITime)) return "tts";
+    return "i";
+  case REALSXP :
+    if (INHERITS(x, char_nanotime)) return "tsn:";
+    if (Rinherits(x, char_integer64)) return "l";
+    if (INHERITS(x, char_POSIXct)) return "tsu:";
+    if (INHERITS(x, char_Date)) return "tdD";
+    return "g";
+  case STRSXP :
+    return "u";
+  default:
+    return NULL;
+  }
+}
+
+static bool exportColumn(SEXP x, struct ArrowSchema *s, struct ArrowArray *a, const char *name) {
+  const char *format = columnFormat(x);
+  const int64_t n = xlength(x);
+  uint8_t *bits = NULL;
+  if (TYPEOF(x)==STRSXP) return exportStrings(x, s, a, name);
+  char tsformat[256];
+  if (!strncmp(format, "ts", 2)) {
+    // a time zone from the tzone attribute, else UTC; the instant is the same
+    const SEXP tz = getAttrib(x, sym_tzone);
+    const bool hasTz = isString(tz) && LENGTH(tz)==1 && STRING_ELT(tz,0)!=NA_STRING && CHAR(STRING_ELT(tz,0))[0];
+    snprintf(tsformat, 256, "%s%s", format, hasTz ? CHAR(STRING_ELT(tz,0)) : "UTC");
+    format = tsformat;
+  }
+  if (!initSchema(s, format, name, 0) || !initArray(a, n, 2, 0)) return false;
+  switch(TYPEOF(x)) {
+  case LGLSXP : {
+    const int *xd = LOGICAL(x);
+    uint8_t *values = alloc64(a, 1, (n+7)/8);
+    if (!values) return false;
+    memset(values, 0, (n+7)/8);
+    for (int64_t i=0; i<n; i++) {
+      if (xd[i]==NA_LOGICAL) SETNULL(a, bits, i)
+      else if (xd[i]) values[i>>3] |= (uint8_t)(1u<<(i&7));
+    }
+  } break;
+  case INTSXP : {
+    const int *xd = INTEGER(x);
+    if (isFactor(x)) {
+      // dictionary encoded: 0-based codes into the levels, which are the dictionary
+      int32_t *codes = alloc64(a, 1, n*sizeof(int32_t));
+      if (!codes) return false;
+      for (int64_t i=0; i<n; i++) {
+        if (xd[i]==NA_INTEGER) { codes[i] = 0; SETNULL(a, bits, i); }
+        else codes[i] = xd[i]-1;
+      }
+      if (isOrdered(x)) s->flags |= ARROW_FLAG_DICTIONARY_ORDERED;
+      // release is cleared as soon as each is allocated, for release() of s and a should the export fail before it's set
+      if ((s->dictionary = malloc(sizeof(struct ArrowSchema)))) s->dictionary->release = NULL;
+      if ((a->dictionary = malloc(sizeof(struct ArrowArray)))) a->dictionary->release = NULL;
+      if (!s->dictionary || !a->dictionary) return false;
+      return exportStrings(getAttrib(x, R_LevelsSymbol), s->dictionary, a->dictionary, "");
+    }
+    for (int64_t i=0; i<n; i++) if (xd[i]==NA_INTEGER) SETNULL(a, bits, i);
+    share(a, x, xd);
+  } break;
+  case REALSXP : {
+    const double *xd = REAL(x);
+    if (format[0]=='l' || !strncmp(format, "tsn", 3)) {
+      const int64_t *xi = (const int64_t *)xd;
+      for (int64_t i=0; i<n; i++) if (xi[i]==NA_INT64_LL) SETNULL(a, bits, i);
+      share(a, x, xd);
+    } else if (format[0]=='t') {
+      // POSIXct seconds to int64 microseconds, Date days to int32
+      const bool date = format[1]=='d';
+      void *values = alloc64(a, 1, n*(date ? sizeof(int32_t) : sizeof(int64_t)));
+      if (!values) return false;
+      for (int64_t i=0; i<n; i++) {
+        if (!R_FINITE(xd[i])) {
+          if (date) ((int32_t *)values)[i] = 0; else ((int64_t *)values)[i] = 0;
+          SETNULL(a, bits, i);
+        }
+        else if (date) ((int32_t *)values)[i] = (int32_t)floor(xd[i]);
+        else ((int64_t *)values)[i] = (int64_t)floor(xd[i]*1e6+0.5);
+      }
+    } else {
+      // NA is null; NaN stays a value, as Arrow has NaN
+      for (int64_t i=0; i<n; i++) if (ISNA(xd[i])) SETNULL(a, bits, i);
+      share(a, x, xd);
+    }
+  } break;
+  default:
+    error(_("Internal error: type '%s' not caught by columnFormat()"), type2char(TYPEOF(x)));  // # nocov
+  }
+  return true;
+}
+
+static bool exportTable(SEXP x, struct ArrowSchema *s, struct ArrowArray *a) {
+  // a struct array with one child per column, as Arrow represents a record batch
+  const int ncol = length(x);
+  const int64_t nrow = ncol ? xlength(VECTOR_ELT(x, 0)) : 0;
+  const SEXP names = getAttrib(x, R_NamesSymbol);
+  if (!initSchema(s, "+s", "", ncol) || !initArray(a, nrow, 1, ncol)) return false;
+  s->flags = 0;
+  for (int j=0; j<ncol; j++) {
+    struct ArrowSchema *cs = s->children[j] = malloc(sizeof(struct ArrowSchema));
+    struct ArrowArray *ca = a->children[j] = malloc(sizeof(struct ArrowArray));
+    if (cs) cs->release = NULL;
+    if (ca) ca->release = NULL;
+    if (!cs || !ca) return false;
+    const char *name = isString(names) ? translateCharUTF8(STRING_ELT(names, j)) : "";
+    if (!exportColumn(VECTOR_ELT(x, j), cs, ca, name)) return false;
+  }
+  return true;
+}
+
+static void finalizeSchema(SEXP p) {
+  struct ArrowSchema *s = R_ExternalPtrAddr(p);
+  if (!s) return;
+  if (s->release) s->release(s);
+  free(s);
+  R_ClearExternalPtr(p);
+}
+
+static void finalizeArray(SEXP p) {
+  struct ArrowArray *a = R_ExternalPtrAddr(p);
+  if (!a) return;
+  if (a->release) a->release(a);
+  free(a);
+  R_ClearExternalPtr(p);
+}
+
+static void *structAddress(SEXP x, const char *arg) {
+  // external pointer, or the address as a number (as from the arrow package) or a string (e.g. "0x55d5c1f0a2b0")
+  void *ans = NULL;
+  if (TYPEOF(x)==EXTPTRSXP) ans = R_ExternalPtrAddr(x);
+  else if (isReal(x) && LENGTH(x)==1 && R_FINITE(REAL(x)[0]) && REAL(x)[0]>0) ans = (void *)(uintptr_t)REAL(x)[0];
+  else if (isString(x) && LENGTH(x)==1 && STRING_ELT(x,0)!=NA_STRING) ans = (void *)(uintptr_t)strtoull(CHAR(STRING_ELT(x,0)), NULL, 0);
+  if (!ans) error(_("'%s' must be an external pointer or the address of a struct %s as a number or string"), arg, arg[0]=='s' ? "ArrowSchema" : "ArrowArray");
+  return ans;
+}
+
+SEXP exportArrowR(SEXP x, SEXP schemaArg, SEXP arrayArg) {
+  if (!isNewList(x) || !INHERITS(x, char_dataframe))
+    error(_("'x' must be a data.table or data.frame"));
+  if (isNull(schemaArg) != isNull(arrayArg))
+    error(_("Provide both 'schema' and 'array', or neither"));
+  const int ncol = length(x);
+  const int64_t nrow = ncol ? xlength(VECTOR_ELT(x, 0)) : 0;
+  for (int j=0; j<ncol; j++) {
+    // checked up front so that the only failure while exporting is running out of memory
+    SEXP col = VECTOR_ELT(x, j);
+    if (!columnFormat(col))
+      error(_("Column %d is type '%s' which cannot be exported to Arrow"), j+1, type2char(TYPEOF(col)));
+    if (xlength(col)!=nrow)
+      error(_("Column %d has %"PRId64" rows but column 1 has %"PRId64), j+1, (int64_t)xlength(col), nrow);
+  }
+  struct ArrowSchema *schema = isNull(schemaArg) ? NULL : structAddress(schemaArg, "schema");
+  struct ArrowArray *array = isNull(arrayArg) ? NULL : structAddress(arrayArg, "array");
+  struct ArrowSchema s = {0};
+  struct ArrowArray a = {0};
+  if (!exportTable(x, &s, &a)) {
+    if (s.release) s.release(&s);
+    if (a.release) a.release(&a);
+    error(_("Unable to allocate memory to export %d columns and %"PRId64" rows to Arrow"), ncol, nrow);  // # nocov
+  }
+  if (schema) {
+    // moved into the consumer's structs, which own them now
+    *schema = s;
+    *array = a;
+    return R_NilValue;
+  }
+  schema = malloc(sizeof(struct ArrowSchema));
+  array = malloc(sizeof(struct ArrowArray));
+  if (!schema || !array) {
+    // # nocov start
+    free(schema); free(array);
+    s.release(&s); a.release(&a);
+    error(_("Unable to allocate memory to export %d columns and %"PRId64" rows to Arrow"), ncol, nrow);
+    // # nocov end
+  }
+  *schema = s;
+  *array = a;
+  SEXP ans = PROTECT(allocVector(VECSXP, 2));
+  SEXP ps = SET_VECTOR_ELT(ans, 0, R_MakeExternalPtr(schema, install("arrow_schema"), R_NilValue));
+  R_RegisterCFinalizerEx(ps, finalizeSchema, TRUE);
+  SEXP pa = SET_VECTOR_ELT(ans, 1, R_MakeExternalPtr(array, install("arrow_array"), R_NilValue));
+  R_RegisterCFinalizerEx(pa, finalizeArray, TRUE);
+  SEXP nms = PROTECT(allocVector(STRSXP, 2));
+  SET_STRING_ELT(nms, 0, mkChar("schema"));
+  SET_STRING_ELT(nms, 1, mkChar("array"));
+  setAttrib(ans, R_NamesSymbol, nms);
+  UNPROTECT(2);
+  return ans;
+}
+
+// Reads an export back, as a consumer would, for the tests to check the formats, null counts, validity bitmaps and
+// buffers; see arrowToList() in wrappers.R. Only the formats exportArrow() produces are decoded.
+
+static SEXP arrowValues(const struct ArrowSchema *s, const struct ArrowArray *a) {
+  const char *f = s->format;
+  const int64_t n = a->length, o = a->offset;
+  const void *b = a->n_buffers>1 ? a->buffers[1] : NULL;
+  SEXP ans;
+  if (!strcmp(f, "b")) {
+    ans = allocVector(LGLSXP, n);
+    for (int64_t i=0; i<n; i++) LOGICAL(ans)[i] = (((const uint8_t *)b)[(i+o)>>3] >> ((i+o)&7)) & 1;
+  } else if (!strcmp(f, "i") || !strcmp(f, "tdD") || !strcmp(f, "tts")) {
+    ans = allocVector(INTSXP, n);
+    for (int64_t i=0; i<n; i++) INTEGER(ans)[i] = ((const int32_t *)b)[i+o];
+  } else if (!strcmp(f, "g")) {
+    ans = allocVector(REALSXP, n);
+    for (int64_t i=0; i<n; i++) REAL(ans)[i] = ((const double *)b)[i+o];
+  } else if (!strcmp(f, "l") || !strncmp(f, "ts", 2)) {
+    // as double, which is exact for the values the tests use
+    ans = allocVector(REALSXP, n);
+    for (int64_t i=0; i<n; i++) REAL(ans)[i] = (double)((const int64_t *)b)[i+o];
+  } else if (!strcmp(f, "u") || !strcmp(f, "U")) {
+    const bool large = f[0]=='U';
+    const char *data = a->buffers[2];
+    ans = PROTECT(allocVector(STRSXP, n));
+    for (int64_t i=0; i<n; i++) {
+      const int64_t from = large ? ((const int64_t *)b)[i+o] : ((const int32_t *)b)[i+o];
+      const int64_t to = large ? ((const int64_t *)b)[i+o+1] : ((const int32_t *)b)[i+o+1];
+      SET_STRING_ELT(ans, i, mkCharLenCE(data+from, (int)(to-from), CE_UTF8));
+    }
+    UNPROTECT(1);
+  } else {
+    error(_("Internal error: arrowToList() does not decode format '%s'"), f);  // # nocov
+  }
+  return ans;
+}
+
+static SEXP arrowColumn(const struct ArrowSchema *s, const struct ArrowArray *a) {
+  // list(format, name, flags, length, null_count, n_buffers, valid, values, dictionary) where valid is the validity
+  // bitmap as logical, or NULL when buffer 0 is NULL (no nulls), and dictionary is the same list for the dictionary
+  const char *names[] = {"format", "name", "flags", "length", "null_count", "n_buffers", "valid", "values", "dictionary", ""};
+  SEXP ans = PROTECT(mkNamed(VECSXP, names));
+  SET_VECTOR_ELT(ans, 0, mkString(s->format));
+  SET_VECTOR_ELT(ans, 1, mkString(s->name ? s->name : ""));
+  SET_VECTOR_ELT(ans, 2, ScalarInteger((int)s->flags));
+  SET_VECTOR_ELT(ans, 3, ScalarReal((double)a->length));
+  SET_VECTOR_ELT(ans, 4, ScalarReal((double)a->null_count));
+  SET_VECTOR_ELT(ans, 5, ScalarInteger((int)a->n_buffers));
+  if (a->n_buffers && a->buffers[0]) {
+    const uint8_t *bits = a->buffers[0];
+    SEXP valid = SET_VECTOR_ELT(ans, 6, allocVector(LGLSXP, a->length));
+    for (int64_t i=0; i<a->length; i++) LOGICAL(valid)[i] = (bits[(i+a->offset)>>3] >> ((i+a->offset)&7)) & 1;
+  }
+  SET_VECTOR_ELT(ans, 7, arrowValues(s, a));
+  if (s->dictionary) SET_VECTOR_ELT(ans, 8, arrowColumn(s->dictionary, a->dictionary));
+  UNPROTECT(1);
+  return ans;
+}
+
+SEXP arrowToListR(SEXP x) {
+  if (!isNewList(x) || LENGTH(x)!=2)
+    error(_("Internal error: arrowToList() takes the list exportArrow() returns"));  // # nocov
+  const struct ArrowSchema *s = structAddress(VECTOR_ELT(x, 0), "schema");
+  const struct ArrowArray *a = structAddress(VECTOR_ELT(x, 1), "array");
+  if (!s->release || !a->release)
+    error(_("The Arrow export has been released"));  // # nocov
+  if (strcmp(s->format, "+s") || s->n_children!=a->n_children)
+    error(_("Internal error: the Arrow export is not a struct array with one child per column"));  // # nocov
+  SEXP ans = PROTECT(allocVector(VECSXP, s->n_children));
+  SEXP nms = PROTECT(allocVector(STRSXP, s->n_children));
+  for (int64_t j=0; j<s->n_children; j++) {
+    SET_VECTOR_ELT(ans, j, arrowColumn(s->children[j], a->children[j]));
+    SET_STRING_ELT(nms, j, mkCharCE(s->children[j]->name, CE_UTF8));
+  }
+  setAttrib(ans, R_NamesSymbol, nms);
+  UNPROTECT(2);
+  return ans;
+}
@@ -523,6 +523,8 @@ SEXP assign(SEXP dt, SEXP rows, SEXP cols, SEXP newcolnames, SEXP values)
       if (vlen<1) continue;   // e.g. DT[,newcol:=integer()] (adding new empty column)
     } else {                 // existing column
       targetcol = VECTOR_ELT(dt,coln);
+      if (fwriteAsyncUses(targetcol))
+        SET_VECTOR_ELT(dt, coln, targetcol=copyAsPlain(targetcol));
     }
     const char *ret = memrecycle(targetcol, rows, 0, targetlen, thisvalue, 0, -1, coln+1, CHAR(STRING_ELT(names, coln)));
     if (ret) warning(ret);
@@ -23,6 +23,8 @@ SEXP coalesce(SEXP x, SEXP inplaceArg) {
   }
   const int nval = length(x)-off;
   if (nval==0) return first;
+  if (inplace && fwriteAsyncUses(first))
+    error(_("setcoalesce() cannot update a column which fwrite(async=TRUE) is still writing. Please call fwriteWait() on its handle first, or use fcoalesce()."));
   const bool factor = isFactor(first);
   const int nrow = length(first);
   for (int i=0; i<nval; ++i) {
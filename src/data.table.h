@@ -58,6 +58,9 @@
 #ifndef MAYBE_REFERENCED
 #  define MAYBE_REFERENCED(x) ( NAMED(x) > 0 )
 #endif
+#if !defined(R_VERSION) || R_VERSION < R_Version(3, 4, 0)
+#  define SET_GROWABLE_BIT(x)  // R before 3.4.0 has no growable vectors; truelength is then only ours
+#endif
 
 // If we find a non-ASCII, non-NA, non-UTF8 encoding, we try to convert it to UTF8. That is, marked non-ascii/non-UTF8 encodings will
 // always be checked in UTF8 locale. This seems to be the best fix Arun could think of to put the encoding issues to rest.
@@ -90,6 +93,7 @@ extern SEXP char_datatable;
 extern SEXP char_dataframe;
 extern SEXP char_NULL;
 extern SEXP char_maxString;
+extern SEXP char_fwriteAsync;
 extern SEXP sym_sorted;
 extern SEXP sym_index;
 extern SEXP sym_BY;
@@ -190,6 +194,9 @@ double i64quickselect(int64_t *x, int n);
 // fread.c
 double wallclock();
 
+// fwriteR.c
+bool fwriteAsyncUses(SEXP col);
+
 // openmp-utils.c
 void initDTthreads();
 int getDTthreads(const int64_t n, const bool throttle);
@@ -155,6 +155,11 @@ SEXP dogroups(SEXP dt, SEXP dtcols, SEXP groups, SEXP grpcols, SEXP jiscols, SEX
   SEXP listwrap = PROTECT(allocVector(VECSXP, 1)); nprotect++;
   Rboolean jexpIsSymbolOtherThanSD = (isSymbol(jexp) && strcmp(CHAR(PRINTNAME(jexp)),".SD")!=0);  // test 559
 
+  for (int j=0; j<length(lhs); ++j) {
+    const int colj = INTEGER(lhs)[j]-1;
+    if (colj<LENGTH(dt) && fwriteAsyncUses(VECTOR_ELT(dt, colj))) SET_VECTOR_ELT(dt, colj, copyAsPlain(VECTOR_ELT(dt, colj)));
+  }
+
   ansloc = 0;
   const int *istarts = INTEGER(starts);
   const int *iorder = INTEGER(order);
@@ -10,6 +10,8 @@
 #ifdef WIN32             // means WIN64, too, oddly
   #include <windows.h>
   #include <stdbool.h>   // true and false
+  #include <io.h>        // _read
+  #include <errno.h>     // errno
 #else
   #include <sys/mman.h>  // mmap
   #include <sys/stat.h>  // fstat for filesize
@@ -24,6 +26,9 @@
   #include <math.h>      // ceil, sqrt, isfinite
 #endif
 #include <stdbool.h>
+#ifndef NOZLIB
+#include <zlib.h>        // inflate for gzip input
+#endif
 #include "fread.h"
 #include "freadLookups.h"
 
@@ -55,19 +60,30 @@ static bool any_number_like_NAstrings=false;
 static bool blank_is_a_NAstring=false;
 static bool stripWhite=true;  // only applies to character columns; numeric fields always stripped
 static bool skipEmptyLines=false, fill=false;
+static int *fwStart = NULL, *fwEnd = NULL;  // fixed-width input (args.widths): column j is bytes [fwStart[j], fwEnd[j]) of each line
+static int fwNcol = 0;
+static bool fixedWidth = false;
 
 static double NA_FLOAT64;  // takes fread.h:NA_FLOAT64_VALUE
 
 // Private globals so they can be cleaned up both on error and on successful return
 static void *mmp = NULL;
 static void *mmp_copy = NULL;
+static void *readBuf = NULL;  // gzip input read from a file descriptor, until it has been inflated into mmp_copy
 static size_t fileSize;
-static int8_t *type = NULL, *tmpType = NULL, *size = NULL;
+static int8_t *type = NULL, *tmpType = NULL, *size = NULL;  // decimalScale is with typeSize above since freadR.c uses it too
+static int *dropRun = NULL;  // dropRun[j] = number of consecutive CT_DROP columns starting at column j
+static int8_t *schemaTypes = NULL;  // detected types plus any out-of-sample bumps, for putRowIndex()
+static int8_t *sampleTypes = NULL;  // detected types before any out-of-sample bump, for putSchema() when args.schemaCache
+static int64_t *rowIndexRow = NULL, *rowIndexOffset = NULL;  // the start of each chunk, recorded for putRowIndex() when args.rowIndex
+static int64_t rowIndexN = 0, rowIndexCap = 0;
 static lenOff *colNames = NULL;
 static freadMainArgs args = {0};  // global for use by DTPRINT; static implies ={0} but include the ={0} anyway just in case for valgrind #4639
 
-const char typeName[NUMTYPE][10] = {"drop", "bool8", "bool8", "bool8", "bool8", "int32", "int64", "float64", "float64", "float64", "int32", "float64", "string"};
-int8_t     typeSize[NUMTYPE]     = { 0,      1,       1,       1,       1,       4,       8,       8,         8,         8,         4,       8       ,  8      };
+const char typeName[NUMTYPE][10] = {"drop", "bool8", "bool8", "bool8", "bool8", "int32", "int64", "decimal", "float64", "float64", "float64", "int32", "float64", "int32", "float64", "string", "factor"};
+int8_t     typeSize[NUMTYPE]     = { 0,      1,       1,       1,       1,       4,       8,       8,         8,         8,         8,         4,       8       ,  4,       8,         8      ,  8      };
+int8_t     *decimalScale = NULL;  // decimal places seen in each column in the sample; the scale of CT_DECIMAL columns
+int8_t     *colDateTimeFormat = NULL;  // index into args.dateTimeFormats of CT_DATE_FMT and CT_TIME_FMT columns, -1 for none; ncol more for detecting the header
 
 // In AIX, NAN and INFINITY don't qualify as constant literals. Refer: PR #3043
 // So we assign them through below init function.
@@ -91,8 +107,44 @@ typedef struct FieldParseContext {
   // String "anchor" for `Field()` parser -- the difference `ch - anchor` will
   // be written out as the string offset.
   const char *anchor;
+  // Number of decimal places for `parse_decimal()`, set from `decimalScale`
+  // for the column being parsed.
+  int8_t scale;
+  // Index of the layout in `args.dateTimeFormats` for `parse_date_format()`
+  // and `parse_datetime_format()`, set from `colDateTimeFormat`.
+  int8_t fmt;
+  // End of the buffer which `ch` points into: `digits8()` reads no further.
+  // `eof` for the input, except in `fw_parse()` which parses a copy.
+  const char *end;
 } FieldParseContext;
 
+// An out-of-sample type exception found while parsing a chunk, kept for the
+// verbose message until the chunk's first row in the result is known.
+typedef struct TypeBump {
+  int j;
+  int8_t from, to;
+  int len;
+  const char *field;
+  int64_t row;  // within the chunk
+} TypeBump;
+
+// One chunk of a wave in the read loop: parsed by any thread, then assigned
+// its rows in the result by the master and pushed by any thread.
+typedef struct ChunkSlot {
+  ThreadLocalFreadParsingContext ctx;
+  // Allocated capacity (rows) of the buffers in `ctx`; grows upon realloc.
+  int64_t buffRows;
+  // Where the chunk started and ended, and where the next jump starts.
+  const char *start, *end, *next;
+  // True when an empty or too-short line is encountered when fill=false, or
+  // a too-long row.
+  bool stopEarly;
+  // Parsed in the wave before, after a dirty jump; the next wave uses it as it is rather than reading it again.
+  bool kept;
+  TypeBump *bumps;
+  int nBump, bumpCap;
+} ChunkSlot;
+
 // Forward declarations
 static void Field(FieldParseContext *ctx);
 
@@ -130,11 +182,23 @@ static char* _const_cast(const char *ptr) {
  */
 bool freadCleanup(void)
 {
-  bool neededCleanup = (type || tmpType || size || colNames || mmp || mmp_copy);
+  bool neededCleanup = (type || tmpType || size || decimalScale || colDateTimeFormat || dropRun || schemaTypes || sampleTypes || rowIndexRow || colNames || mmp || mmp_copy || readBuf || fwStart);
   free(type); type = NULL;
   free(tmpType); tmpType = NULL;
+  free(decimalScale); decimalScale = NULL;
+  free(colDateTimeFormat); colDateTimeFormat = NULL;
   free(size); size = NULL;
+  free(dropRun); dropRun = NULL;
+  free(schemaTypes); schemaTypes = NULL;
+  free(sampleTypes); sampleTypes = NULL;
+  free(rowIndexRow); rowIndexRow = NULL;
+  free(rowIndexOffset); rowIndexOffset = NULL;
+  rowIndexN = rowIndexCap = 0;
   free(colNames); colNames = NULL;
+  free(fwStart); fwStart = NULL;
+  free(fwEnd); fwEnd = NULL;
+  fwNcol = 0;
+  fixedWidth = false;
   if (mmp != NULL) {
     // Important to unmap as OS keeps internal reference open on file. Process is not exiting as
     // we're a .so/.dll here. If this was a process exiting we wouldn't need to unmap.
@@ -153,6 +217,7 @@ bool freadCleanup(void)
     mmp = NULL;
   }
   free(mmp_copy); mmp_copy = NULL;
+  free(readBuf); readBuf = NULL;
   fileSize = 0;
   sep = whiteChar = quote = dec = '\0';
   quoteRule = -1;
@@ -222,6 +287,13 @@ static char *typesAsString(int ncol) {
   return str;
 }
 
+static bool widenable(int8_t from, int8_t to) {
+  // true when every value read as type 'from' is read the same as type 'to', so that rows already read need converting
+  // rather than rereading after an out-of-sample bump. Not int64 to float64 as parse_double rounds large values its own way.
+  return (from==CT_BOOL8_N || from==CT_INT32) &&
+         (to==CT_INT32 || to==CT_INT64 || to==CT_FLOAT64 || to==CT_FLOAT64_EXT);
+}
+
 
 static inline void skip_white(const char **pch) {
   // skip space so long as sep isn't space and skip tab so long as sep isn't tab
@@ -277,6 +349,190 @@ static inline bool end_of_field(const char *ch) {
 }
 
 
+/**
+ * SWAR ("SIMD within a register"): test 8 bytes at once using plain 64-bit integer arithmetic, so there is no
+ * dependence on the instruction set. Each returns a word with the high bit set in exactly those bytes of x that
+ * match (there are no false positives from borrows between bytes), so the first match is __builtin_ctzll(m)/8.
+ * Only enabled on little endian where the first byte in memory is the lowest byte of the word.
+ */
+#if defined(__GNUC__) && defined(__BYTE_ORDER__) && __BYTE_ORDER__==__ORDER_LITTLE_ENDIAN__
+  #define SWAR 1
+#else
+  #define SWAR 0
+#endif
+#define SWAR_ONES  0x0101010101010101ULL
+#define SWAR_HIGHS 0x8080808080808080ULL
+static inline uint64_t swar_load(const char *ch) { uint64_t x; memcpy(&x, ch, 8); return x; }
+static inline uint64_t swar_eq(uint64_t x, uint8_t c) {  // bytes equal to c
+  uint64_t t = x ^ (SWAR_ONES*c);
+  return ~(((t & ~SWAR_HIGHS) + ~SWAR_HIGHS) | t) & SWAR_HIGHS;
+}
+static inline uint64_t swar_lt(uint64_t x, uint8_t c) {  // bytes less than c, for c<=128
+  return ~(((x & ~SWAR_HIGHS) + SWAR_ONES*(0x80-c)) | x) & SWAR_HIGHS;
+}
+
+/**
+ * Returns the first \n or \r at or after ch, or eof. \0 before eof is just data here as elsewhere.
+ */
+static inline const char *next_eol_byte(const char *ch)
+{
+  #if SWAR
+  for (; ch+8<=eof; ch+=8) {
+    uint64_t x = swar_load(ch);
+    uint64_t m = swar_eq(x, '\n') | swar_eq(x, '\r');
+    if (m) return ch + __builtin_ctzll(m)/8;
+  }
+  #endif
+  while (ch<eof && *ch!='\n' && *ch!='\r') ch++;
+  return ch;
+}
+
+/**
+ * Moves over the bytes which cannot end an unquoted field: returns the first byte at or after ch which is sep or
+ * a control character (so could be \r, \n or the \0 at eof), or a position within 8 bytes of eof.
+ * Used by Field() and hence countfields() and type detection, so long string fields are scanned 8 bytes at a time.
+ */
+static inline const char *skip_plain(const char *ch)
+{
+  #if SWAR
+  for (; ch+8<=eof; ch+=8) {
+    uint64_t x = swar_load(ch);
+    uint64_t m = swar_eq(x, (uint8_t)sep) | swar_lt(x, 14);
+    if (m) return ch + __builtin_ctzll(m)/8;
+  }
+  #endif
+  return ch;
+}
+
+/**
+ * Number of \n in [ch, end).
+ */
+static uint64_t count_newlines(const char *ch, const char *end)
+{
+  uint64_t n = 0;
+  #if SWAR
+  for (; ch+8<=end; ch+=8) n += (uint64_t)__builtin_popcountll(swar_eq(swar_load(ch), '\n'));
+  #endif
+  for (; ch<end; ch++) n += (*ch=='\n');
+  return n;
+}
+
+/**
+ * Returns the start of the line n lines after ch (i.e. just after the n-th \n), or end if [ch, end) has fewer; *nfound is
+ * set to the number of lines passed. Used for large skip= and nrows= so that a 30GB file need not be walked line by line by
+ * one thread to find where rows 50M to 51M are. The input is counted in rounds of nth blocks of 4MB, one block per
+ * thread, and the round that contains the n-th \n is walked to find it. Only \n line endings are handled: NULL is
+ * returned if a \r is seen before the n-th line ends, so that \r and \r\n files take the single-threaded route.
+ * Like wc -l and skip=, newlines inside quoted fields are counted as lines.
+ */
+#define SKIP_PARALLEL_MIN 100000  // lines; fewer are quicker to walk in one thread than to count with a team
+static const char *skip_lines_parallel(const char *ch, const char *end, uint64_t n, int nth, uint64_t *nfound)
+{
+  const size_t blockBytes = 4*1024*1024;
+  uint64_t *cnt = malloc((size_t)nth * sizeof(uint64_t));
+  bool *hasCR = malloc((size_t)nth * sizeof(bool));
+  if (!cnt || !hasCR) STOP(_("Failed to allocate %d counts for skip_lines_parallel"), nth);  // # nocov
+  uint64_t found = 0;
+  const char *ans = end;
+  while (ch<end && found<n) {
+    const size_t roundBytes = umin(blockBytes*(size_t)nth, (size_t)(end-ch));
+    const size_t each = (roundBytes + (size_t)nth - 1) / (size_t)nth;
+    #pragma omp parallel for num_threads(nth)
+    for (int t=0; t<nth; t++) {
+      const char *b = ch + umin((size_t)t*each, roundBytes), *e = ch + umin((size_t)(t+1)*each, roundBytes);
+      cnt[t] = count_newlines(b, e);
+      hasCR[t] = b<e && memchr(b, '\r', (size_t)(e-b))!=NULL;
+    }
+    for (int t=0; t<nth; t++) {
+      if (hasCR[t]) { ans = NULL; break; }
+      if (found + cnt[t] >= n) {
+        const char *p = ch + umin((size_t)t*each, roundBytes);
+        while (found<n) { p = (const char *)memchr(p, '\n', (size_t)(end-p)) + 1; found++; }
+        ans = p;
+        break;
+      }
+      found += cnt[t];
+    }
+    if (ans!=end) break;
+    ch += roundBytes;
+  }
+  free(cnt);
+  free(hasCR);
+  *nfound = found;
+  return ans;
+}
+
+static uint64_t fnv1a(uint64_t h, const void *p, size_t n)
+{
+  const uint8_t *b = (const uint8_t *)p;
+  for (size_t i=0; i<n; i++) { h ^= b[i]; h *= 0x100000001b3ULL; }
+  return h;
+}
+
+
+/**
+ * Moves *pch over up to n whole fields, each of which must be followed by sep, and returns how many were passed.
+ * Used to skip runs of dropped columns without calling Field() on each one. Fields quoted in the standard way
+ * (quote rule 0, closing quote followed directly by sep) are skipped too. Otherwise it stops early at the start of
+ * a field containing a quote or a control character (which includes \r, \n, \0 and eof), and leaves that field
+ * to Field() which knows how to handle it. The result is the same as calling Field() and stepping over sep n times.
+ */
+static const char *end_of_quoted_field(const char *ch)
+{
+  // ch is on the opening quote; returns the sep after the closing quote, or NULL if that's not what follows
+  ch++;
+  while ((ch = memchr(ch, quote, (size_t)(eof-ch))) && ch+1<eof && ch[1]==quote) ch+=2;
+  return (ch && ch+1<eof && ch[1]==sep) ? ch+1 : NULL;
+}
+
+static int skip_fields(const char **pch, int n)
+{
+  const char *ch = *pch, *fieldStart = ch;
+  const bool quoted = quote && quoteRule<3;
+  int done = 0;
+  #if SWAR
+  while (ch+8<=eof) {
+    uint64_t x = swar_load(ch);
+    uint64_t seps = swar_eq(x, (uint8_t)sep);
+    uint64_t stop = seps | swar_lt(x, 14);
+    if (quoted) stop |= swar_eq(x, (uint8_t)quote);
+    int nsep = __builtin_popcountll(seps);
+    if (stop==seps && done+nsep<n) {
+      // common case for short fields: only separators in these 8 bytes and not the last one we're looking for
+      if (nsep) { done += nsep; fieldStart = ch + (63-__builtin_clzll(seps))/8 + 1; }
+      ch += 8;
+      continue;
+    }
+    const char *next = ch+8;
+    while (stop) {
+      const char *at = ch + __builtin_ctzll(stop)/8;
+      if (*at!=sep) {
+        if (*at!=quote || at!=fieldStart || quoteRule!=0 || !(at = end_of_quoted_field(at))) { *pch = fieldStart; return done; }
+        next = at;  // continue the 8 byte steps from the sep after the quoted field
+      }
+      fieldStart = at+1;
+      if (++done==n) { *pch = fieldStart; return done; }
+      if (at>=next) { next = at+1; break; }
+      stop &= stop-1;
+    }
+    ch = next;
+  }
+  #endif
+  for (; ch<eof; ch++) {
+    if (*ch==quote && quoted && ch==fieldStart && quoteRule==0) {
+      const char *end = end_of_quoted_field(ch);
+      if (end) ch = end;
+    }
+    if (*ch==sep) {
+      fieldStart = ch+1;
+      if (++done==n) break;
+    } else if ((uint8_t)*ch<14 || (quoted && *ch==quote)) break;
+  }
+  *pch = fieldStart;
+  return done;
+}
+
+
 static inline const char *end_NA_string(const char *start) {
   // start should be at the beginning of any potential NA string, after leading whitespace skipped by caller
   const char* const* nastr = NAstrings;
@@ -292,6 +548,34 @@ static inline const char *end_NA_string(const char *start) {
 }
 
 
+/**
+ * Fixed-width input: returns the eol (or eof) that ends the line containing ch. A \r which is not part of a line ending
+ * is data, as elsewhere.
+ */
+static inline const char *fw_line_end(const char *ch)
+{
+  for (;;) {
+    ch = next_eol_byte(ch);
+    const char *t = ch;
+    if (ch==eof || eol(&t)) return ch;
+    ch++;
+  }
+}
+
+/**
+ * Fixed-width input: the bytes of column j on the line from line to lineEnd, as [return value, *end). They are clipped
+ * to the line so that the columns past the end of a short line are empty.
+ */
+static inline const char *fw_field(const char *line, const char *lineEnd, int j, const char **end)
+{
+  const char *s = line + fwStart[j], *e = line + fwEnd[j];
+  if (e>lineEnd) e = lineEnd;
+  if (s>e) s = e;
+  *end = e;
+  return s;
+}
+
+
 /**
  * Compute the number of fields on the current line (taking into account the
  * global `sep` and `quoteRule`), and move the parsing location to the
@@ -306,6 +590,14 @@ static inline int countfields(const char **pch)
   static void *targets[9];
   targets[8] = (void*) &trash;
   const char *ch = *pch;
+  if (fixedWidth) {
+    // every line has all the columns; those past the end of a short line are empty
+    const char *lineEnd = fw_line_end(ch);
+    skip_white(&ch);
+    *pch = lineEnd;
+    if (lineEnd<eof && eol(pch)) (*pch)++;
+    return ch==lineEnd ? 0 : fwNcol;
+  }
   if (sep==' ') while (*ch==' ') ch++;  // multiple sep==' ' at the start does not mean sep
   skip_white(&ch);
   if (eol(&ch) || ch==eof) {
@@ -317,6 +609,7 @@ static inline int countfields(const char **pch)
     .ch = &ch,
     .targets = targets,
     .anchor = NULL,
+    .end = eof,
   };
   while (ch<eof) {
     Field(&ctx);
@@ -349,7 +642,7 @@ static inline const char *nextGoodLine(const char *ch, int ncol)
   // If this doesn't return the true line start, no matter. The previous thread will run-on and
   // resolve it. A good guess is all we need here. Being wrong will just be a bit slower.
   // If there are no embedded newlines, all newlines are true, and this guess will never be wrong.
-  while (*ch!='\n' && *ch!='\r' && (*ch!='\0' || ch<eof)) ch++;
+  ch = next_eol_byte(ch);
   if (ch==eof) return eof;
   if (eol(&ch)) // move to last byte of the line ending sequence (e.g. \r\r\n would be +2).
     ch++;       // and then move to first byte of next line
@@ -360,7 +653,7 @@ static inline const char *nextGoodLine(const char *ch, int ncol)
   while (attempts++<5 && ch<eof) {
     const char *ch2 = ch;
     if (countfields(&ch2)==ncol) return ch;  // returns simpleNext here on first attempt, almost all the time
-    while (*ch!='\n' && *ch!='\r' && (*ch!='\0' || ch<eof)) ch++;
+    ch = next_eol_byte(ch);
     if (eol(&ch)) ch++;
   }
   return simpleNext;
@@ -442,6 +735,202 @@ void copyFile(size_t fileSize, const char *msg, bool verbose)  // only called in
   if (verbose) DTPRINT(_("  File copy in RAM took %.3f seconds.\n"), tt);
 }
 
+static inline uint32_t le32(const unsigned char *p) { return (uint32_t)p[0] | (uint32_t)p[1]<<8 | (uint32_t)p[2]<<16 | (uint32_t)p[3]<<24; }
+
+/**
+ * Parse the header of the gzip member starting at `p` (at most `n` bytes available). Returns the
+ * number of header bytes (i.e. the offset of the deflate data) or 0 if this is not a valid gzip
+ * header. If the header carries a BGZF 'BC' extra subfield, the total size of the member is
+ * returned in `*blockSize`, otherwise `*blockSize` is set to 0 (member size unknown without inflating).
+ */
+static size_t gzipHeader(const unsigned char *p, size_t n, size_t *blockSize)
+{
+  *blockSize = 0;
+  if (n<18 || p[0]!=0x1f || p[1]!=0x8b || p[2]!=8) return 0;
+  int flg = p[3];
+  size_t i = 10;
+  if (flg & 4) {  // FEXTRA
+    size_t xlen = (size_t)p[10] | (size_t)p[11]<<8;
+    i = 12;
+    if (i+xlen>n) return 0;
+    for (size_t x=i; x+4<=i+xlen; ) {
+      size_t slen = (size_t)p[x+2] | (size_t)p[x+3]<<8;
+      if (p[x]=='B' && p[x+1]=='C' && slen==2 && x+6<=i+xlen) *blockSize = ((size_t)p[x+4] | (size_t)p[x+5]<<8) + 1;
+      x += 4+slen;
+    }
+    i += xlen;
+  }
+  if (flg & 8)  { while (i<n && p[i]) i++; i++; }  // FNAME
+  if (flg & 16) { while (i<n && p[i]) i++; i++; }  // FCOMMENT
+  if (flg & 2) i+=2;                                // FHCRC
+  return i<n ? i : 0;
+}
+
+/**
+ * Read the input from a file descriptor to its end into readBuf, for input that cannot be memory-mapped
+ * such as the read end of a pipe from a command. The buffer grows by half as much again each time it
+ * fills, as when inflating, and keeps 1 extra byte so that [4] can always write the terminating \0.
+ */
+static void readFd(int fd, bool verbose)
+{
+  double tt = wallclock();
+  size_t alloc = 1024*1024, n = 0;
+  readBuf = malloc(alloc);
+  if (!readBuf) STOP(_("Unable to allocate %s of contiguous virtual RAM to read the input."), filesize_to_str(alloc)); // # nocov
+  while (true) {
+    if (n+1==alloc) {
+      alloc = alloc + alloc/2;
+      void *tmp = realloc(readBuf, alloc);
+      if (!tmp) STOP(_("Unable to allocate %s of contiguous virtual RAM to read the input."), filesize_to_str(alloc));  // # nocov
+      readBuf = tmp;
+    }
+    size_t want = umin(alloc-1-n, 1<<30);
+    #ifdef WIN32
+      int got = _read(fd, (char *)readBuf + n, (unsigned int)want);
+    #else
+      ssize_t got = read(fd, (char *)readBuf + n, want);
+    #endif
+    if (got==0) break;
+    if (got<0) {
+      if (errno==EINTR) continue;                                                      // # nocov
+      STOP(_("System errno %d reading the input: %s"), errno, strerror(errno));        // # nocov
+    }
+    n += (size_t)got;
+  }
+  fileSize = n;
+  if (verbose) DTPRINT(_("  Read %s from file descriptor %d in %.3f seconds\n"), filesize_to_str(n), fd, wallclock()-tt);
+}
+
+/**
+ * The input is gzip compressed (magic bytes 1f 8b). Inflate it into mmp_copy and point sof/eof at that.
+ * The caller releases the compressed input (the mmap of the file, or the buffer read from a file
+ * descriptor) afterwards. Block compressed files (bgzip/BGZF, as commonly
+ * used for large genomics and log exports) know the size of every member up front, and the size of its
+ * output from the trailer, so all blocks are inflated in parallel straight into their place in the
+ * result. Ordinary gzip (including the concatenated members written by fwrite) is inflated serially.
+ * The buffer is allocated with 1 extra byte so that [4] can always write the terminating \0.
+ */
+static void inflateInput(const unsigned char *in, size_t inSize, int nth, bool verbose)
+{
+#ifdef NOZLIB
+  STOP(_("Input is gzip compressed but data.table was compiled without zlib so cannot decompress it. Please reinstall data.table with zlib available, or decompress the file first.")); // # nocov
+#else
+  double tt = wallclock();
+  size_t blockSize = 0;
+  size_t nblock = 0, outSize = 0;
+  size_t hdr = gzipHeader(in, inSize, &blockSize);
+  if (!hdr) STOP(_("Input starts with the gzip magic bytes but its gzip header is invalid or truncated."));
+  if (blockSize) {
+    // First pass: walk the member headers and trailers only (no inflating) to check every member
+    // is a BGZF block and to total the uncompressed size.
+    size_t p = 0;
+    while (p<inSize) {
+      // the header and 8 byte trailer must fit in the block size, else reading the trailer and the length of the
+      // deflate data (bs-h-8) would run past the block
+      size_t bs, h = gzipHeader(in+p, inSize-p, &bs);
+      if (!h || bs<18+8 || p+bs>inSize || h>bs-8) { blockSize=0; break; }
+      outSize += le32(in+p+bs-4);
+      p += bs;
+      nblock++;
+    }
+  }
+  if (blockSize) {
+    if (verbose) DTPRINT(_("  gzip input is block compressed (BGZF) with %"PRIu64" blocks; inflating in parallel using %d threads\n"), (uint64_t)nblock, nth);
+    mmp_copy = malloc(outSize + 1/* extra \0 */);
+    if (!mmp_copy) STOP(_("Unable to allocate %s of contiguous virtual RAM to decompress the gzip input."), filesize_to_str(outSize));
+    size_t *blockStart = malloc(2*nblock*sizeof(size_t));  // input offset, then output offset, of each block
+    if (!blockStart) STOP(_("Unable to allocate %s of contiguous virtual RAM to decompress the gzip input."), filesize_to_str(2*nblock*sizeof(size_t))); // # nocov
+    size_t *outStart = blockStart + nblock;
+    for (size_t b=0, p=0, o=0; b<nblock; b++) {
+      size_t bs;
+      gzipHeader(in+p, inSize-p, &bs);
+      blockStart[b] = p;
+      outStart[b] = o;
+      o += le32(in+p+bs-4);
+      p += bs;
+    }
+    int failed = Z_OK;
+    #pragma omp parallel for num_threads(nth) schedule(dynamic)
+    for (size_t b=0; b<nblock; b++) {
+      if (failed!=Z_OK) continue;
+      const unsigned char *blk = in + blockStart[b];
+      size_t bs, h = gzipHeader(blk, inSize-blockStart[b], &bs);
+      uint32_t isize = le32(blk+bs-4);
+      z_stream strm = {0};
+      int ret = inflateInit2(&strm, -15);  // raw deflate; the header has been parsed and the trailer is checked below
+      if (ret==Z_OK) {
+        strm.next_in = (unsigned char *)blk + h;
+        strm.avail_in = (uInt)(bs-h-8);
+        strm.next_out = (unsigned char *)mmp_copy + outStart[b];
+        strm.avail_out = (uInt)isize;
+        ret = inflate(&strm, Z_FINISH);
+        if (ret==Z_STREAM_END && strm.total_out==isize &&
+            (uint32_t)crc32(0L, (unsigned char *)mmp_copy + outStart[b], isize)==le32(blk+bs-8)) ret = Z_OK;
+        else if (ret==Z_OK || ret==Z_STREAM_END || ret==Z_BUF_ERROR) ret = Z_DATA_ERROR;
+        inflateEnd(&strm);
+      }
+      if (ret!=Z_OK) {
+        #pragma omp atomic write
+        failed = ret;
+      }
+    }
+    free(blockStart);
+    if (failed!=Z_OK) STOP(_("zlib %s failed to inflate a block of the BGZF input (error %d). The file is probably corrupt or truncated."), zlibVersion(), failed);
+  } else {
+    // ISIZE of the last member is the uncompressed size (mod 2^32) when there is just one member. Use it as the
+    // first guess unless it's implausible (deflate can't exceed 1032:1, or truncated input), in which case start
+    // with a typical 3x compression ratio; the buffer grows if needed.
+    size_t alloc = le32(in+inSize-4);
+    if (alloc<inSize || alloc/1032>inSize) alloc = 3*inSize;
+    alloc++;
+    mmp_copy = malloc(alloc);
+    if (!mmp_copy) STOP(_("Unable to allocate %s of contiguous virtual RAM to decompress the gzip input."), filesize_to_str(alloc));
+    if (verbose) DTPRINT(_("  gzip input is not block compressed so is being inflated serially into a buffer of initial size %s\n"), filesize_to_str(alloc));
+    z_stream strm = {0};
+    int ret = inflateInit2(&strm, 15+16);  // +16 for gzip header and trailer
+    if (ret!=Z_OK) STOP(_("zlib %s inflateInit2 returned error %d"), zlibVersion(), ret); // # nocov
+    strm.next_in = (unsigned char *)in;
+    size_t inLeft = inSize;
+    while (true) {
+      if (strm.avail_in==0) {
+        strm.avail_in = (uInt)umin(inLeft, 1<<30);  // avail_in is 32bit
+        inLeft -= strm.avail_in;
+      }
+      if (outSize+1==alloc) {
+        alloc = alloc + alloc/2;
+        void *tmp = realloc(mmp_copy, alloc);
+        if (!tmp) { inflateEnd(&strm); STOP(_("Unable to allocate %s of contiguous virtual RAM to decompress the gzip input."), filesize_to_str(alloc)); }
+        mmp_copy = tmp;
+      }
+      strm.next_out = (unsigned char *)mmp_copy + outSize;
+      strm.avail_out = (uInt)umin(alloc-1-outSize, 1<<30);
+      size_t before = strm.avail_out;
+      ret = inflate(&strm, Z_NO_FLUSH);
+      outSize += before - strm.avail_out;
+      if (ret==Z_STREAM_END) {
+        // concatenated members (e.g. written by fwrite one per batch) are valid gzip too; trailing zero padding is ignored
+        if (strm.avail_in==0 && inLeft==0) break;
+        if (strm.avail_in<2 || strm.next_in[0]!=0x1f || strm.next_in[1]!=0x8b) break;
+        ret = inflateReset(&strm);
+      }
+      if (ret!=Z_OK && !(ret==Z_BUF_ERROR && strm.avail_out==0)) {
+        inflateEnd(&strm);
+        STOP(_("zlib %s inflate() returned error %d (%s) after %s of output. The gzip input is probably corrupt or truncated."),
+             zlibVersion(), ret, strm.msg ? strm.msg : "input ended unexpectedly", filesize_to_str(outSize));
+      }
+    }
+    inflateEnd(&strm);
+  }
+  if (verbose) {
+    DTPRINT(_("  Inflated %s of gzip input"), filesize_to_str(inSize));  // filesize_to_str uses one static buffer so not twice in one call
+    DTPRINT(_(" to %s in %.3f seconds\n"), filesize_to_str(outSize), wallclock()-tt);
+  }
+  fileSize = outSize;
+  sof = mmp_copy;
+  eof = sof + fileSize;
+#endif
+}
+
 
 //==============================================================================
 // Field parsers
@@ -496,7 +985,7 @@ static void Field(FieldParseContext *ctx)
   const char *fieldStart=ch;
   if (*ch!=quote || quoteRule==3 || quote=='\0') {
     // Most common case. Unambiguously not quoted. Simply search for sep|eol. If field contains sep|eol then it should have been quoted and we do not try to heal that.
-    while(!end_of_field(ch)) ch++;  // sep, \r, \n or eof will end
+    while(!end_of_field(ch = skip_plain(ch))) ch++;  // sep, \r, \n or eof will end
     *(ctx->ch) = ch;
     int fieldLen = (int)(ch-fieldStart);
     //if (stripWhite) {   // TODO:  do this if and the next one together once in bulk afterwards before push
@@ -572,7 +1061,36 @@ static void Field(FieldParseContext *ctx)
   }
 }
 
-static void str_to_i32_core(const char **pch, int32_t *target)
+#if defined(__GNUC__) && defined(__BYTE_ORDER__) && __BYTE_ORDER__==__ORDER_LITTLE_ENDIAN__
+#define SWAR_DIGITS  // 8 digits at a time using 64-bit integer operations; plain C so no runtime CPU dispatch is needed
+#endif
+
+static inline bool digits8(const char *ch, const char *end, uint_fast64_t *acc)
+{
+  // If the 8 bytes at ch are all decimal digits, appends them to *acc and returns true. They are checked and combined at
+  // once by a few 64-bit operations (SWAR): in pairs, fours and then all eight. Callers loop on this and then finish with
+  // the usual digit-at-a-time loop. Shorter runs were measured slower this way than by that loop, whose branch predicts well
+  // when a column's fields have similar lengths; for the same reason parse_double_regular_core does not use this since its
+  // parts are usually shorter than 8. Within 8 bytes of end, the end of the buffer which ch points into, it returns false
+  // so as not to read past; end==NULL, for short fields such as the parts of a date, also returns false.
+  #ifdef SWAR_DIGITS
+  if (end==NULL || end-ch<8) return false;
+  uint64_t v;
+  memcpy(&v, ch, 8);                              // ch[0] is the low byte
+  const uint64_t x = v ^ 0x3030303030303030ULL;  // a digit byte is now its value 0-9
+  if ((x | (x + 0x0606060606060606ULL)) & 0xF0F0F0F0F0F0F0F0ULL) return false;  // any other byte has a bit in 0xF0 now or after adding 6
+  uint64_t d = (x * 2561) >> 8;                                  // 10*256+1: pairs of digits in the even bytes
+  d = ((d & 0x00FF00FF00FF00FFULL) * 6553601) >> 16;             // 100*65536+1: fours in the even 16-bit words
+  d = ((d & 0x0000FFFF0000FFFFULL) * 42949672960001ULL) >> 32;   // 10000*2^32+1: all eight
+  *acc = *acc * 100000000 + d;
+  return true;
+  #else
+  (void)ch; (void)end; (void)acc;
+  return false;
+  #endif
+}
+
+static void str_to_i32_core(const char **pch, const char *end, int32_t *target)
 {
   const char *ch = *pch;
 
@@ -591,6 +1109,7 @@ static void str_to_i32_core(const char **pch, int32_t *target)
   // number significant figures = digits from the first non-zero onwards including trailing zeros
   while (*ch=='0') ch++;
   uint_fast32_t sf = 0;
+  while (digits8(ch+sf, end, &acc)) sf += 8;  // acc may wrap after 19 digits but then sf>10 below rejects it
   while ( (digit=AS_DIGIT(ch[sf]))<10 ) {
     acc = 10*acc + digit;
     sf++;
@@ -612,7 +1131,7 @@ static void str_to_i32_core(const char **pch, int32_t *target)
 
 static void StrtoI32(FieldParseContext *ctx)
 {
-  str_to_i32_core(ctx->ch, (int32_t*) ctx->targets[sizeof(int32_t)]);
+  str_to_i32_core(ctx->ch, ctx->end, (int32_t*) ctx->targets[sizeof(int32_t)]);
 }
 
 
@@ -628,6 +1147,7 @@ static void StrtoI64(FieldParseContext *ctx)
   uint_fast64_t acc = 0;  // important unsigned not signed here; we now need the full unsigned range
   uint_fast8_t digit;
   uint_fast32_t sf = 0;
+  while (digits8(ch+sf, ctx->end, &acc)) sf += 8;
   while ( (digit=AS_DIGIT(ch[sf]))<10 ) {
     acc = 10*acc + digit;
     sf++;
@@ -648,6 +1168,59 @@ static void StrtoI64(FieldParseContext *ctx)
 }
 
 
+static const int64_t pow10int64[19] = {1, 10, 100, 1000, 10000, 100000, 1000000, 10000000, 100000000, 1000000000,
+  10000000000, 100000000000, 1000000000000, 10000000000000, 100000000000000, 1000000000000000,
+  10000000000000000, 100000000000000000, 1000000000000000000};
+
+/**
+ * Parse [+|-] (NNN|NNN.|.MMM|NNN.MMM) with at most ctx->scale significant
+ * decimal places into the integer NNNMMM * 10^(scale - number of M), exactly.
+ * Further trailing zeros are accepted. More decimal places, an exponent, or
+ * more than 18 digits in total fail so that the column is bumped to float64.
+ */
+static void parse_decimal(FieldParseContext *ctx)
+{
+  const char *ch = *(ctx->ch);
+  int64_t *target = (int64_t*) ctx->targets[sizeof(int64_t)];
+  const int scale = ctx->scale;
+  if (*ch=='0' && args.keepLeadingZeros && IS_DIGIT(ch[1])) return;
+  bool neg = *ch=='-';
+  ch += (neg || *ch=='+');
+  const char *start = ch;
+  while (*ch=='0') ch++;
+  uint_fast64_t acc = 0;
+  uint_fast8_t digit;
+  int sf = 0;
+  while ( (digit=AS_DIGIT(ch[sf]))<10 ) {
+    acc = 10*acc + digit;
+    sf++;
+  }
+  ch += sf;
+  if (sf + scale > 18) goto fail;
+  bool any = ch>start;
+  int d = 0;
+  if (*ch==dec) {
+    ch++;
+    while (d<scale && (digit=AS_DIGIT(*ch))<10) {
+      acc = 10*acc + digit;
+      d++;
+      ch++;
+    }
+    while (*ch=='0') ch++;
+    if (IS_DIGIT(*ch)) goto fail;  // more decimal places than the scale
+    any |= ch>start+1;
+  }
+  if (!any) goto fail;
+  acc *= (uint_fast64_t)pow10int64[scale-d];
+  *target = neg ? -(int64_t)acc : (int64_t)acc;
+  *(ctx->ch) = ch;
+  return;
+
+  fail:
+    *target = NA_INT64;
+}
+
+
 // generate freadLookups.h
 // TODO: review ERANGE checks and tests; that range outside [1.7e-308,1.7e+308] coerces to [0.0,Inf]
 /*
@@ -951,13 +1524,22 @@ rows = paste0(apply(matrix(t, ncol = 4L, byrow = TRUE), 1L, paste, collapse = ',
 cat(rows, sep='', file=f, append=TRUE)
 cat(146097, '// total days in 400 years\n};\n', sep = '', file=f, append=TRUE)
 */
+static inline int32_t days_since_epoch(int32_t year, int32_t month, int32_t day, bool isLeapYear)
+{
+  return
+    (year/400 - 4)*cumDaysCycleYears[400] + // days to beginning of 400-year cycle
+    cumDaysCycleYears[year % 400] + // days to beginning of year within 400-year cycle
+    (isLeapYear ? cumDaysCycleMonthsLeap[month-1] : cumDaysCycleMonthsNorm[month-1]) + // days to beginning of month within year
+    day-1; // day within month (subtract 1: 1970-01-01 -> 0)
+}
+
 static void parse_iso8601_date_core(const char **pch, int32_t *target)
 {
   const char *ch = *pch;
 
   int32_t year=0, month=0, day=0;
 
-  str_to_i32_core(&ch, &year);
+  str_to_i32_core(&ch, NULL, &year);
 
   // .Date(.Machine$integer.max*c(-1, 1)):
   //  -5877641-06-24 -- 5881580-07-11
@@ -970,21 +1552,17 @@ static void parse_iso8601_date_core(const char **pch, int32_t *target)
   bool isLeapYear = year % 4 == 0 && (year % 100 != 0 || year/100 % 4 == 0);
   ch++;
 
-  str_to_i32_core(&ch, &month);
+  str_to_i32_core(&ch, NULL, &month);
   if (month == NA_INT32 || month < 1 || month > 12 || *ch != '-')
     goto fail;
   ch++;
 
-  str_to_i32_core(&ch, &day);
+  str_to_i32_core(&ch, NULL, &day);
   if (day == NA_INT32 || day < 1 ||
       (day > (isLeapYear ? leapYearDays[month-1] : normYearDays[month-1])))
     goto fail;
 
-  *target =
-    (year/400 - 4)*cumDaysCycleYears[400] + // days to beginning of 400-year cycle
-    cumDaysCycleYears[year % 400] + // days to beginning of year within 400-year cycle
-    (isLeapYear ? cumDaysCycleMonthsLeap[month-1] : cumDaysCycleMonthsNorm[month-1]) + // days to beginning of month within year
-    day-1; // day within month (subtract 1: 1970-01-01 -> 0)
+  *target = days_since_epoch(year, month, day, isLeapYear);
 
   *pch = ch;
   return;
@@ -1013,12 +1591,12 @@ static void parse_iso8601_timestamp(FieldParseContext *ctx)
     // allows date-only field in a column with UTC-marked datetimes to be parsed as UTC too; test 2150.13
   ch++;
 
-  str_to_i32_core(&ch, &hour);
+  str_to_i32_core(&ch, NULL, &hour);
   if (hour == NA_INT32 || hour < 0 || hour > 23 || *ch != ':')
     goto fail;
   ch++;
 
-  str_to_i32_core(&ch, &minute);
+  str_to_i32_core(&ch, NULL, &minute);
   if (minute == NA_INT32 || minute < 0 || minute > 59 || *ch != ':')
     goto fail;
   ch++;
@@ -1035,7 +1613,7 @@ static void parse_iso8601_timestamp(FieldParseContext *ctx)
     if (*ch == '+' || *ch == '-') {
       const char *start = ch; // facilitates distinguishing +04, +0004, +0000, +00:00
       // three recognized formats: [+-]AA:BB, [+-]AABB, and [+-]AA
-      str_to_i32_core(&ch, &tz_hour);
+      str_to_i32_core(&ch, NULL, &tz_hour);
       if (tz_hour == NA_INT32)
         goto fail;
       if (ch - start == 5 && tz_hour != 0) { // +AABB
@@ -1048,7 +1626,7 @@ static void parse_iso8601_timestamp(FieldParseContext *ctx)
           goto fail;
         if (*ch == ':') {
           ch++;
-          str_to_i32_core(&ch, &tz_minute);
+          str_to_i32_core(&ch, NULL, &tz_minute);
           if (tz_minute == NA_INT32)
             goto fail;
         }
@@ -1075,6 +1653,143 @@ static void parse_iso8601_timestamp(FieldParseContext *ctx)
     *target = NA_FLOAT64;
 }
 
+/*
+ * Dates and datetimes in the layouts of args.dateTimeFormats. A layout is a subset of strptime():
+ *   %Y 4-digit year, %y 2-digit year (00-68 is 20xx), %m month, %d day, %b month abbreviation (Jan-Dec, any case),
+ *   %H hour, %I hour 1-12 with %p AM|PM, %M minute, %S or %OS seconds with optional fraction, %% a literal %
+ * where %m, %d, %H, %I, %M and %S take 1 or 2 digits. Any other character must match itself. Datetimes are UTC.
+ * The layouts "epoch", "epoch_ms", "epoch_us" and "epoch_ns" are numbers (possibly fractional) of that unit since
+ * 1970-01-01 UTC. All layouts are checked at R level.
+ */
+bool dateTimeFormatIsTime(const char *format)
+{
+  if (strncmp(format, "epoch", 5)==0) return true;
+  for (const char *f=format; *f; f++) if (*f=='%') {
+    f++;
+    if (*f=='H' || *f=='I') return true;
+    if (*f=='\0') break;
+  }
+  return false;
+}
+
+static inline bool dt_digits(const char **pch, int maxd, int exact, int32_t *target)
+{
+  const char *ch = *pch;
+  int32_t acc = 0;
+  int n = 0;
+  while (n<maxd && IS_DIGIT(ch[n])) { acc = acc*10 + (ch[n]-'0'); n++; }
+  if (n==0 || (exact && n!=exact)) return false;
+  *target = acc;
+  *pch = ch+n;
+  return true;
+}
+
+static bool parse_datetime_layout(const char **pch, const char *f, int32_t *date, double *seconds)
+{
+  const char *ch = *pch;
+  if (strncmp(f, "epoch", 5)==0) {
+    double v;
+    parse_double_regular_core(&ch, &v);
+    if (!isfinite(v)) return false;  // including NA_FLOAT64 written on failure
+    f += 5;
+    *seconds = f[0]=='\0' ? v : v / (f[1]=='m' ? 1e3 : f[1]=='u' ? 1e6 : 1e9);
+    *date = 0;
+    *pch = ch;
+    return true;
+  }
+  int32_t year=NA_INT32, month=0, day=0, hour=0, minute=0;
+  double second=0;
+  int pm = -1;        // %p: 0 AM, 1 PM
+  bool anyTime = false;
+  while (*f) {
+    if (*f!='%' || f[1]=='%') {
+      if (*f=='%') f++;
+      if (*ch!=*f) {
+        // a date-only field in a datetime column is midnight, like parse_iso8601_timestamp()
+        if (!anyTime && year!=NA_INT32 && month && day && end_of_field(ch)) break;
+        return false;
+      }
+      ch++; f++;
+      continue;
+    }
+    f++;
+    if (*f=='O') f++;  // %OS
+    switch(*f++) {
+    case 'Y': if (!dt_digits(&ch, 4, 4, &year)) return false; break;
+    case 'y': if (!dt_digits(&ch, 2, 2, &year)) return false; year += year<69 ? 2000 : 1900; break;
+    case 'm': if (!dt_digits(&ch, 2, 0, &month)) return false; break;
+    case 'd': if (!dt_digits(&ch, 2, 0, &day)) return false; break;
+    case 'b': {
+      static const char months[] = "janfebmaraprmayjunjulaugsepoctnovdec";
+      char m[3];
+      for (int k=0; k<3; k++) { m[k] = (char)(ch[k] | 0x20); if (m[k]<'a' || m[k]>'z') return false; }  // ASCII lower case
+      month = 0;
+      for (int k=0; k<12; k++) if (m[0]==months[3*k] && m[1]==months[3*k+1] && m[2]==months[3*k+2]) { month = k+1; break; }
+      if (!month) return false;
+      ch += 3;
+    } break;
+    case 'H': case 'I': if (!dt_digits(&ch, 2, 0, &hour)) return false; anyTime = true; break;
+    case 'M': if (!dt_digits(&ch, 2, 0, &minute)) return false; anyTime = true; break;
+    case 'S': {
+      int32_t s;
+      if (!dt_digits(&ch, 2, 0, &s)) return false;
+      second = s;
+      if (*ch=='.' && IS_DIGIT(ch[1])) {
+        ch++;
+        double p = 0.1;
+        while (IS_DIGIT(*ch)) { second += (*ch-'0')*p; p /= 10; ch++; }
+      }
+      anyTime = true;
+    } break;
+    case 'p':
+      if      ((ch[0]=='A' || ch[0]=='a') && (ch[1]=='M' || ch[1]=='m')) pm = 0;
+      else if ((ch[0]=='P' || ch[0]=='p') && (ch[1]=='M' || ch[1]=='m')) pm = 1;
+      else return false;
+      ch += 2;
+      break;
+    default: return false;  // # nocov; checked at R level
+    }
+  }
+  if (pm>=0) {
+    if (hour<1 || hour>12) return false;
+    hour = hour%12 + 12*pm;
+  }
+  if (year==NA_INT32 || month<1 || month>12 || hour>23 || minute>59 || second>=60) return false;
+  bool isLeapYear = year % 4 == 0 && (year % 100 != 0 || year/100 % 4 == 0);
+  if (day<1 || day > (isLeapYear ? leapYearDays[month-1] : normYearDays[month-1])) return false;
+  *date = days_since_epoch(year, month, day, isLeapYear);
+  *seconds = 3600*hour + 60*minute + second;
+  *pch = ch;
+  return true;
+}
+
+static void parse_date_format(FieldParseContext *ctx)
+{
+  int32_t *target = (int32_t*) ctx->targets[sizeof(int32_t)];
+  int32_t date;
+  double seconds;
+  if (ctx->fmt>=0 && parse_datetime_layout(ctx->ch, args.dateTimeFormats[ctx->fmt], &date, &seconds)) *target = date;
+  else *target = NA_INT32;
+}
+
+static void parse_datetime_format(FieldParseContext *ctx)
+{
+  double *target = (double*) ctx->targets[sizeof(double)];
+  int32_t date;
+  double seconds;
+  if (ctx->fmt>=0 && parse_datetime_layout(ctx->ch, args.dateTimeFormats[ctx->fmt], &date, &seconds)) *target = 86400*(double)date + seconds;
+  else *target = NA_FLOAT64;
+}
+
+static int nextDateTimeFormat(int from, bool time)
+{
+  // the next layout from index `from` to try when detecting a column of type CT_DATE_FMT (time=false) or CT_TIME_FMT, or -1
+  for (int k=from; k>=0 && args.dateTimeFormats && args.dateTimeFormats[k]; k++) {
+    if (args.dateTimeDetect[k] && dateTimeFormatIsTime(args.dateTimeFormats[k])==time) return k;
+  }
+  return -1;
+}
+
 /* Parse numbers 0 | 1 as boolean and ,, as NA (fwrite's default) */
 static void parse_bool_numeric(FieldParseContext *ctx)
 {
@@ -1158,21 +1873,106 @@ static reader_fun_t fun[NUMTYPE] = {
   (reader_fun_t) &parse_bool_lowercase,
   (reader_fun_t) &StrtoI32,
   (reader_fun_t) &StrtoI64,
+  (reader_fun_t) &parse_decimal,
   (reader_fun_t) &parse_double_regular,
   (reader_fun_t) &parse_double_extended,
   (reader_fun_t) &parse_double_hexadecimal,
   (reader_fun_t) &parse_iso8601_date,
   (reader_fun_t) &parse_iso8601_timestamp,
+  (reader_fun_t) &parse_date_format,
+  (reader_fun_t) &parse_datetime_format,
+  (reader_fun_t) &Field,
   (reader_fun_t) &Field
 };
 
-static int disabled_parsers[NUMTYPE] = {0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0};
+static int disabled_parsers[NUMTYPE] = {0, 0, 0, 0, 0, 0, 0, 1, 0, 0, 0, 0, 0, 1, 1, 0, 0};  // CT_DECIMAL is only reached by user override
+
+/**
+ * Fixed-width input: parses the field [s,e) with the parser of type t into ctx->targets as if it were a delimited field,
+ * so numbers may be padded with spaces. The parsers stop at the first byte which cannot be part of the value, which in a
+ * fixed-width line may be the next column (e.g. 12345 then 678), so other than strings the field is copied to a small
+ * buffer ending with \n first. Strings are not copied: their offset from ctx->anchor is recorded as Field() does. Returns
+ * false when the field is not valid for type t.
+ */
+static bool fw_parse(FieldParseContext *ctx, int8_t t, const char *s, const char *e)
+{
+  if (t==CT_DROP) return true;
+  if (t>=CT_STRING) {
+    lenOff *target = (lenOff*) ctx->targets[sizeof(lenOff)];
+    if (stripWhite) {
+      while (s<e && *s==' ') s++;
+      while (e>s && e[-1]==' ') e--;
+    }
+    int32_t len = (int32_t)(e-s);
+    if ((len==0 && blank_is_a_NAstring) || (len && end_NA_string(s)==e)) len = INT32_MIN;
+    target->off = (int32_t)(s - ctx->anchor);
+    target->len = len;
+    return true;
+  }
+  while (s<e && (*s==' ' || *s=='\t')) s++;
+  while (e>s && (e[-1]==' ' || e[-1]=='\t')) e--;
+  char buf[128];
+  size_t n = (size_t)(e-s);
+  if (n>sizeof(buf)-2) return false;  // too long for any number or date
+  memcpy(buf, s, n);
+  buf[n] = '\n';
+  buf[n+1] = '\0';
+  const char *ch = buf;
+  if (n && end_NA_string(buf)==buf+n) ch = buf+n;  // the parser writes NA as for an empty field
+  const char **saved = ctx->ch, *savedEnd = ctx->end;
+  ctx->ch = &ch;
+  ctx->end = buf+sizeof(buf);  // not eof, which is not in buf
+  fun[t](ctx);
+  ctx->ch = saved;
+  ctx->end = savedEnd;
+  return ch==buf+n;
+}
 
-static int detect_types( const char **pch, int8_t type[], int ncol, bool *bumped) {
+static int detect_types_fw(const char **pch, int8_t fmt[], bool *bumped) {
+  // detect_types() for fixed-width input; a blank line is a row of NA unless skipEmptyLines
+  const char *line = *pch, *ch = line;
+  double trash;
+  void *targets[9] = {NULL, &trash, NULL, NULL, &trash, NULL, NULL, NULL, &trash};
+  FieldParseContext fctx = {
+    .ch = &ch,
+    .targets = targets,
+    .anchor = NULL,
+    .end = eof,
+  };
+  const char *lineEnd = fw_line_end(line);
+  *pch = lineEnd;
+  skip_white(&ch);
+  if (ch==lineEnd && skipEmptyLines) return 0;
+  for (int field=0; field<fwNcol; field++) {
+    const char *e, *s = fw_field(line, lineEnd, field, &e);
+    while (tmpType[field]<CT_STRING) {
+      fctx.fmt = fmt[field];
+      if (fw_parse(&fctx, tmpType[field], s, e)) break;
+      if (tmpType[field]==CT_DATE_FMT || tmpType[field]==CT_TIME_FMT) {
+        int k = nextDateTimeFormat(fmt[field]+1, tmpType[field]==CT_TIME_FMT);
+        if (k>=0) { fmt[field] = (int8_t)k; *bumped = true; continue; }
+      }
+      while (++tmpType[field]<CT_STRING && disabled_parsers[tmpType[field]]) {};
+      if (tmpType[field]==CT_DATE_FMT || tmpType[field]==CT_TIME_FMT) fmt[field] = (int8_t)nextDateTimeFormat(0, tmpType[field]==CT_TIME_FMT);
+      *bumped = true;
+    }
+    if (tmpType[field]==CT_FLOAT64) {
+      const char *d = s;
+      while (d<e && *d!=dec) d++;
+      int k = 0;
+      if (d<e) while (d+k+1<e && IS_DIGIT(d[k+1])) k++;
+      if (k>decimalScale[field]) decimalScale[field] = (int8_t)imin(k, INT8_MAX);
+    }
+  }
+  return fwNcol;
+}
+
+static int detect_types( const char **pch, int8_t type[], int8_t fmt[], int ncol, bool *bumped) {
   // used in sampling column types and whether column names are present
   // test at most ncol fields. If there are fewer fields, the data read step later
   // will error (if fill==false) when the line number is known, so we don't need to handle that here.
   // leave resting on the eol; caller will advance over that eol
+  if (fixedWidth) return detect_types_fw(pch, fmt, bumped);
   const char *ch = *pch;
   double trash; // double so that this throw-away storage is aligned. char trash[8] would not be aligned.
   void *targets[9] = {NULL, &trash, NULL, NULL, &trash, NULL, NULL, NULL, &trash};
@@ -1180,6 +1980,7 @@ static int detect_types( const char **pch, int8_t type[], int ncol, bool *bumped
     .ch = &ch,
     .targets = targets,
     .anchor = NULL,
+    .end = eof,
   };
   if (sep==' ') while (*ch==' ') ch++;  // multiple sep=' ' at the beginning of a line does not mean sep
   skip_white(&ch);
@@ -1190,6 +1991,7 @@ static int detect_types( const char **pch, int8_t type[], int ncol, bool *bumped
     skip_white(&ch);
     const char *fieldStart = ch;
     while (tmpType[field]<=CT_STRING) {
+      fctx.fmt = fmt[field];
       fun[tmpType[field]](&fctx);
       if (end_of_field(ch)) break;
       skip_white(&ch);
@@ -1213,9 +2015,23 @@ static int detect_types( const char **pch, int8_t type[], int ncol, bool *bumped
         }
       }
       ch = fieldStart;
+      if (tmpType[field]==CT_DATE_FMT || tmpType[field]==CT_TIME_FMT) {
+        // try the remaining layouts in turn before the next type
+        int k = nextDateTimeFormat(fmt[field]+1, tmpType[field]==CT_TIME_FMT);
+        if (k>=0) { fmt[field] = (int8_t)k; *bumped = true; continue; }
+      }
       while (++tmpType[field]<CT_STRING && disabled_parsers[tmpType[field]]) {};
+      if (tmpType[field]==CT_DATE_FMT || tmpType[field]==CT_TIME_FMT) fmt[field] = (int8_t)nextDateTimeFormat(0, tmpType[field]==CT_TIME_FMT);
       *bumped = true;
     }
+    if (tmpType[field]==CT_FLOAT64) {
+      // decimal places, for the scale of the column should it be overridden to CT_DECIMAL
+      const char *d = fieldStart;
+      while (d<ch && *d!=dec) d++;
+      int k = 0;
+      if (d<ch) while (IS_DIGIT(d[k+1])) k++;
+      if (k>decimalScale[field]) decimalScale[field] = (int8_t)imin(k, INT8_MAX);
+    }
     field++;
     if (sep==' ' && *ch==sep) {
       while (ch[1]==' ') ch++;
@@ -1297,6 +2113,8 @@ int freadMain(freadMainArgs _args) {
   }
   disabled_parsers[CT_BOOL8_N] = !args.logical01;
   disabled_parsers[CT_ISO8601_DATE] = disabled_parsers[CT_ISO8601_TIME] = args.oldNoDateTime; // temporary new option in v1.13.0; see NEWS
+  disabled_parsers[CT_DATE_FMT] = args.oldNoDateTime || nextDateTimeFormat(0, false)<0;
+  disabled_parsers[CT_TIME_FMT] = args.oldNoDateTime || nextDateTimeFormat(0, true)<0 || !args.noTZasUTC;  // as unmarked ISO-8601 datetimes with tz=""
   if (verbose) {
     if (*NAstrings == NULL) {
       DTPRINT(_("  No NAstrings provided.\n"));
@@ -1325,6 +2143,20 @@ int freadMain(freadMainArgs _args) {
   if (dec=='\0') STOP(_("dec='' not allowed. Should be '.' or ','"));
   if (args.sep == dec) STOP(_("sep == dec ('%c') is not allowed"), dec);
   if (quote == dec) STOP(_("quote == dec ('%c') is not allowed"), dec);
+  fixedWidth = args.nwidths>0;
+  if (fixedWidth) {
+    fwStart = (int *)malloc((size_t)args.nwidths * sizeof(int));
+    fwEnd = (int *)malloc((size_t)args.nwidths * sizeof(int));
+    if (!fwStart || !fwEnd) STOP(_("Failed to allocate 2 x %d ints for widths: %s"), args.nwidths, strerror(errno));
+    int at = 0;
+    for (int i=0; i<args.nwidths; i++) {
+      int w = args.widths[i];
+      if (w==0 || w==INT32_MIN || abs(w) > INT32_MAX-at) STOP(_("widths[%d]=%d is not a valid width"), i+1, w);
+      if (w>0) { fwStart[fwNcol] = at; fwEnd[fwNcol++] = at+w; }
+      at += abs(w);
+    }
+    if (fwNcol==0) STOP(_("widths= has no positive widths so there are no columns to read"));
+  }
   // since quote=='\0' when user passed quote="", the logic in this file uses '*ch==quote && quote' otherwise
   //   the ending \0 at eof could be treated as a quote (test xxx)
 
@@ -1343,7 +2175,7 @@ int freadMain(freadMainArgs _args) {
   {
   if (verbose) DTPRINT(_("[02] Opening the file\n"));
   mmp = NULL;
-  if (args.input) {
+  if (args.input && !args.inputSize) {
     if (verbose) DTPRINT(_("  `input` argument is provided rather than a file name, interpreting as raw text to read\n"));
     sof = args.input;
     fileSize = strlen(sof);
@@ -1405,6 +2237,46 @@ int freadMain(freadMainArgs _args) {
     }
     sof = (const char*) mmp;
     if (verbose) DTPRINT(_("  Memory mapped ok\n"));
+    if (fileSize>=18 && (unsigned char)sof[0]==0x1f && (unsigned char)sof[1]==0x8b) {
+      // gzip magic; decompress in-process rather than the user or R needing to decompress to a temporary file first
+      size_t mapSize = fileSize;
+      inflateInput((const unsigned char *)mmp, fileSize, nth, verbose);
+      // Release the compressed file now rather than at the end, to return that address space before the read
+      #ifdef WIN32
+        UnmapViewOfFile(mmp);
+      #else
+        munmap(mmp, mapSize);
+      #endif
+      mmp = NULL;
+    }
+  }
+  else if (args.input || args.inputFd>=0) {
+    // In memory already (e.g. an R raw vector) or from a pipe, rather than from a temporary file written first
+    const unsigned char *in = (const unsigned char *)args.input;
+    if (in) {
+      fileSize = args.inputSize;
+      if (verbose) DTPRINT(_("  `input` is a buffer of %s in memory\n"), filesize_to_str(fileSize));
+    } else {
+      readFd(args.inputFd, verbose);
+      if (fileSize==0) {
+        freadCleanup();
+        return 0;  // e.g. a command that output nothing; the caller decides what that means
+      }
+      in = readBuf;
+    }
+    if (fileSize>=18 && in[0]==0x1f && in[1]==0x8b) {
+      inflateInput(in, fileSize, nth, verbose);
+      free(readBuf); readBuf = NULL;
+    } else if (readBuf) {
+      mmp_copy = readBuf;  // has the extra byte for \0 already
+      readBuf = NULL;
+    } else {
+      // The buffer is not ours to write the terminating \0 to, so copy it. Much cheaper than writing it to a file to be read back.
+      mmp_copy = malloc(fileSize + 1/* extra \0 */);
+      if (!mmp_copy) STOP(_("Unable to allocate %s of contiguous virtual RAM to copy the input."), filesize_to_str(fileSize));
+      memcpy(mmp_copy, in, fileSize);
+    }
+    sof = mmp_copy;
   } else {
     STOP(_("Internal error: Neither `input` nor `filename` are given, nothing to read.")); // # nocov
   }
@@ -1453,15 +2325,22 @@ int freadMain(freadMainArgs _args) {
   if (verbose) DTPRINT(_("[04] Arrange mmap to be \\0 terminated\n"));
 
   // First, set 'eol_one_r' for use by eol() to know if \r-only line ending is allowed, #2371
-  ch = sof;
-  while (ch<eof && *ch!='\n') ch++;
-  eol_one_r = (ch==eof);
+  eol_one_r = !memchr(sof, '\n', (size_t)(eof-sof));
   if (verbose) DTPRINT(eol_one_r ?
     _("  No \\n exists in the file at all, so single \\r (if any) will be taken as one line ending. This is unusual but will happen normally when there is no \\r either; e.g. a single line missing its end of line.\n") :
     _("  \\n has been found in the input and different lines can end with different line endings (e.g. mixed \\n and \\r\\n in one file). This is common and ideal.\n"));
 
+  int64_t tailEnd = -1;  // args.tail: the input is read up to here, after the last \n, so that a line being appended is left for next time
+  if (args.tail) {
+    ch = eof;
+    while (ch>sof && ch[-1]!='\n') ch--;
+    if (ch>sof) eof = ch;
+    tailEnd = eof-sof;
+    if (verbose) DTPRINT(_("  tail=TRUE: reading up to the last \\n at byte %"PRId64" of %"PRIu64"\n"), tailEnd, (uint64_t)fileSize);
+  }
+
   bool lastEOLreplaced = false;
-  if (args.filename) {
+  if (mmp || mmp_copy) {  // not text input, which is \0-terminated already
     // eof is currently resting after the last byte of the file (so don't even read it there; bus error if fileSize%4096==0)
     ch = eof-1;
     if (eol_one_r) {
@@ -1481,7 +2360,7 @@ int freadMain(freadMainArgs _args) {
     }
     if (!lastEOLreplaced) {
       // very unusual branch because properly formed csv will have final eol
-      if (fileSize%4096!=0) {
+      if (mmp_copy || fileSize%4096!=0) {  // mmp_copy here is decompressed input which has an extra byte
         if (verbose) DTPRINT(_("  File ends abruptly with '%c'. Final end-of-line is missing. Using cow page to write 0 to the last byte.\n"), eof[-1]);
         // We could do this routinely (i.e. when there is a final newline too) but we desire to run all tests through the harder
         // branch above that replaces the final newline with \0 to test that logic (e.g. test 893 which causes a type bump in the last
@@ -1533,15 +2412,27 @@ int freadMain(freadMainArgs _args) {
                   args.skipString);
     while (ch>sof && ch[-1]!='\n') ch--;  // move to beginning of line
     pos = ch;
-    ch = sof;
-    while (ch<pos) row1line+=(*ch++=='\n');
+    row1line += (int)count_newlines(sof, pos);
     if (verbose) DTPRINT(_("Found skip='%s' on line %"PRIu64". Taking this to be header row or first row of data.\n"),
                          args.skipString, (uint64_t)row1line);
     ch = pos;
   }
   else if (args.skipNrow >= 0) {
     // Skip the first `skipNrow` lines of input, including 0 to force the first line to be the start
+    if (nth>1 && args.skipNrow>=SKIP_PARALLEL_MIN) {
+      uint64_t found = 0;
+      const char *end = skip_lines_parallel(ch, eof, (uint64_t)args.skipNrow, nth, &found);
+      if (end) {
+        ch = end;
+        row1line += (int)found;
+        if (verbose) DTPRINT(_("  Counted %"PRIu64" lines using %d threads\n"), found, nth);
+      } else if (verbose) {
+        DTPRINT(_("  \\r found in the input so skipping lines one by one\n"));
+      }
+    }
     while (ch < eof && row1line <= args.skipNrow) {
+      ch = next_eol_byte(ch);
+      if (ch == eof) break;
       char c = *ch++;
       if (c == '\n' || c == '\r') {
         ch += (ch < eof && c + ch[0] == '\n' + '\r');
@@ -1578,7 +2469,89 @@ int freadMain(freadMainArgs _args) {
   const char *firstJumpEnd=NULL; // remember where the winning jumpline from jump 0 ends, to know its size excluding header
   const char *prevStart = NULL;  // the start of the non-empty line before the first not-ignored row (for warning message later, or taking as column names)
   int jumpLines = (int)umin(100,nrowLimit);   // how many lines from each jump point to use. If nrowLimit is supplied, nJumps is later set to 1 as well.
-  {
+  int autoSkip = 0;              // lines skipped to reach the first row (topSkip below); part of the schema
+  freadSchema schema = {0};
+  uint64_t schemaKey = 0;
+  bool schemaUsed = false, schemaSavable = args.schemaCache && !fill && args.sep!='\n' && !fixedWidth;
+  freadRowIndex rowIndex = {0};
+  bool rowIndexUsed = args.rowIndex && getRowIndex(&rowIndex);
+  if (rowIndexUsed) {
+    // The layout and types recorded when the whole input was read are used as a schema which is known to fit; see [10] for the rows
+    bool fits = rowIndex.ncol>=1 && rowIndex.n>=1 && rowIndex.firstRowOffset>=0 && rowIndex.firstRowOffset<eof-sof &&
+                rowIndex.offset[rowIndex.n-1]<=(args.tail ? tailEnd : eof-sof);
+    // the layouts are numbers into this call's dateTimeFormats, which R level checks are those the row index was built with
+    int nFormats = 0;
+    while (args.dateTimeFormats && args.dateTimeFormats[nFormats]) nFormats++;
+    for (int j=0; fits && j<rowIndex.ncol; j++) {
+      const int8_t t = rowIndex.types[j], k = rowIndex.fmt[j];
+      fits = rowIndex.scale[j]>=0 && k<nFormats && (t==CT_DATE_FMT || t==CT_TIME_FMT ? k>=0 : k>=-1);
+    }
+    if (!fits)
+      STOP(_("The row index does not fit this input. Please remove the row index file so that it is built again."));
+    if (verbose) DTPRINT(_("[06] Using the row index: %d columns, %"PRId64" rows, %"PRId64" entries\n"), rowIndex.ncol, rowIndex.nrow, rowIndex.n);
+    schemaSavable = false;
+    schemaUsed = true;
+    ncol = rowIndex.ncol;
+    sep = rowIndex.sep;
+    whiteChar = (sep==' ' ? '\t' : (sep=='\t' ? ' ' : 0));
+    quoteRule = rowIndex.quoteRule;
+    pos = sof + rowIndex.firstRowOffset;
+    size_t dataBytes = (size_t)(eof-pos);
+    double meanLen = rowIndex.nrow>0 ? (double)dataBytes/rowIndex.nrow : (double)dataBytes;
+    freadSchema s = {ncol, rowIndex.types, sep, quoteRule, rowIndex.header, 0, meanLen>1 ? meanLen : 1, 0, 1};
+    schema = s;
+  }
+  else if (schemaSavable) {
+    // The key is the first line, the size class of the input and the arguments which affect detection
+    schemaKey = 0xcbf29ce484222325ULL;
+    schemaKey = fnv1a(schemaKey, pos, (size_t)(next_eol_byte(pos)-pos));
+    int sizeClass = 0;
+    for (size_t sz=(size_t)(eof-pos); sz; sz>>=1) sizeClass++;
+    char opts[] = {args.sep, args.quote, args.dec, (char)args.header, args.skipEmptyLines, args.stripWhite, args.keepLeadingZeros,
+                   args.noTZasUTC, (char)sizeClass, NUMTYPE};
+    schemaKey = fnv1a(schemaKey, opts, sizeof(opts));
+    schemaKey = fnv1a(schemaKey, disabled_parsers, sizeof(disabled_parsers));
+    for (const char* const* nastr=NAstrings; nastr && *nastr; nastr++) schemaKey = fnv1a(schemaKey, *nastr, strlen(*nastr)+1);
+    for (int k=0; args.dateTimeFormats && args.dateTimeFormats[k]; k++) {
+      if (args.dateTimeDetect[k]) schemaKey = fnv1a(schemaKey, args.dateTimeFormats[k], strlen(args.dateTimeFormats[k])+1);
+    }
+    if (getSchema(schemaKey, &schema) && schema.ncol>1) {
+      // Check the schema fits: jumpLines rows after the lines to skip must all have ncol fields using its sep and quote rule
+      if (verbose) {
+        DTPRINT(_("[06] Checking the cached schema for key %016"PRIx64":"), schemaKey);
+        DTPRINT((unsigned)schema.sep<32 ? "  sep=%#02x" : "  sep='%c'", schema.sep);
+        DTPRINT(_("  with %d fields using quote rule %d after %d lines\n"), schema.ncol, schema.quoteRule, schema.topSkip);
+      }
+      sep = schema.sep;
+      whiteChar = (sep==' ' ? '\t' : (sep=='\t' ? ' ' : 0));
+      quoteRule = schema.quoteRule;
+      ch = pos;
+      for (int i=0; i<schema.topSkip && ch<eof; i++) countfields(&ch);
+      const char *start = ch;
+      int i = 0;
+      while (ch<eof && i<jumpLines) {
+        int thisncol = countfields(&ch);
+        if (thisncol==0 && skipEmptyLines) continue;
+        if (thisncol!=schema.ncol) break;
+        i++;
+      }
+      if (i==jumpLines) {
+        schemaUsed = true;
+        ncol = schema.ncol;
+        pos = start;
+        row1line += autoSkip = schema.topSkip;
+        firstJumpEnd = ch;
+        if (quoteRule>1 && quote)
+          DTWARN(_("Found and resolved improper quoting in first %d rows. If the fields are not quoted (e.g. field separator does not appear within any field), try quote=\"\" to avoid this warning."), jumpLines);
+        if (verbose) DTPRINT(_("  Cached schema fits the first %d rows starting on line %d. Skipping detection.\n"), jumpLines, row1line);
+      } else if (verbose) {
+        DTPRINT(_("  Cached schema does not fit row %d after line %d. Detecting as usual.\n"), i+1, row1line+schema.topSkip);
+      }
+    } else if (verbose) {
+      DTPRINT(_("  No cached schema for key %016"PRIx64"\n"), schemaKey);
+    }
+  }
+  if (!schemaUsed) {
   if (verbose) DTPRINT(_("[06] Detect separator, quoting rule, and ncolumns\n"));
 
   if (args.sep == '\n') {  // '\n' because '\0' is taken already to mean 'auto'
@@ -1596,6 +2569,17 @@ int freadMain(freadMainArgs _args) {
     firstJumpEnd = ch;  // size of first 100 lines in bytes is used later for nrow estimate
     fill = true;        // so that blank lines are read as empty
     ch = pos;
+  } else if (fixedWidth) {
+    if (verbose) DTPRINT(_("  widths= passed in: %d fixed-width columns, the last ending at byte %d of each line\n"), fwNcol, fwEnd[fwNcol-1]);
+    sep = 127;     // as for sep='\n'; fields are found by position so there is no sep or quoting
+    whiteChar = 0;
+    quoteRule = 3;
+    ncol = fwNcol;
+    int thisLine=0;
+    while (ch<eof && thisLine++<jumpLines) countfields(&ch);
+    firstJumpEnd = ch;
+    fill = true;   // short lines have empty fields at the end
+    ch = pos;
   } else {
     int nseps;
     char seps[]=",|;\t ";  // default seps in order of preference. See ?fread.
@@ -1733,7 +2717,7 @@ int freadMain(freadMainArgs _args) {
     } else {
       // TODO: warning here if topSkip>0 that header is being auto-removed.
       ch = pos = topStart;
-      row1line += topSkip;
+      row1line += autoSkip = topSkip;
     }
   }
 
@@ -1750,7 +2734,7 @@ int freadMain(freadMainArgs _args) {
 
   if (ncol==1 && lastEOLreplaced && (eof[-1]=='\n' || eof[-1]=='\r')) {
     // Multiple newlines at the end are significant in the case of 1-column files only (multiple NA at the end)
-    if (fileSize%4096==0) {
+    if (!mmp_copy && fileSize%4096==0) {
       const char *msg = _("This file is very unusual: it's one single column, ends with 2 or more end-of-line (representing several NA at the end), and is a multiple of 4096, too.");
       if (verbose) DTPRINT(_("  Copying file in RAM. %s\n"), msg);
       ASSERT(mmp_copy==NULL, "mmp has already been copied due to abrupt non-eol ending, so it does not end with 2 or more eol.", 1/*dummy arg for macro*/); // #nocov
@@ -1775,14 +2759,20 @@ int freadMain(freadMainArgs _args) {
   int64_t estnrow=1;
   int64_t allocnrow=0;     // Number of rows in the allocated DataTable
   double meanLineLen=0.0; // Average length (in bytes) of a single line in the input file
+  double sdLineLen=0.0;
+  int minLineLen=0;
   size_t bytesRead=0;     // Bytes in the data section (i.e. excluding column names, header and footer, if any)
-  {
+  if (!schemaUsed) {
   if (verbose) DTPRINT(_("[07] Detect column types, good nrow estimate and whether first row is column names\n"));
   if (verbose && args.header!=NA_BOOL8) DTPRINT(_("  'header' changed by user from 'auto' to %s\n"), args.header?"true":"false");
 
   type =    (int8_t *)malloc((size_t)ncol * sizeof(int8_t));
   tmpType = (int8_t *)malloc((size_t)ncol * sizeof(int8_t));  // used i) in sampling to not stop on errors when bad jump point and ii) when accepting user overrides
-  if (!type || !tmpType) STOP(_("Failed to allocate 2 x %d bytes for type and tmpType: %s"), ncol, strerror(errno));
+  decimalScale = (int8_t *)calloc((size_t)ncol, sizeof(int8_t));
+  colDateTimeFormat = (int8_t *)malloc((size_t)ncol * 2 * sizeof(int8_t));
+  if (!type || !tmpType || !decimalScale || !colDateTimeFormat)
+    STOP(_("Failed to allocate 5 x %d bytes for type, tmpType, decimalScale and colDateTimeFormat: %s"), ncol, strerror(errno));
+  memset(colDateTimeFormat, -1, (size_t)ncol * 2);
 
   int8_t type0 = 1;
   while (disabled_parsers[type0]) type0++;
@@ -1837,7 +2827,7 @@ int freadMain(freadMainArgs _args) {
 
     while(ch<eof && jumpLine++<jumpLines) {
       const char *lineStart = ch;
-      int thisNcol = detect_types(&ch, tmpType, ncol, &bumped);
+      int thisNcol = detect_types(&ch, tmpType, colDateTimeFormat, ncol, &bumped);
       if (thisNcol==0 && skipEmptyLines) {
         if (eol(&ch)) ch++;
         continue;
@@ -1879,7 +2869,7 @@ int freadMain(freadMainArgs _args) {
   if (args.header==NA_BOOL8) {
     for (int j=0; j<ncol; j++) tmpType[j]=type0;   // reuse tmpType
     bool bumped=false;
-    detect_types(&ch, tmpType, ncol, &bumped);
+    detect_types(&ch, tmpType, colDateTimeFormat+ncol, ncol, &bumped);  // the layouts found for the data rows are kept
     if (sampleLines>0) for (int j=0; j<ncol; j++) {
       if (tmpType[j]==CT_STRING && type[j]<CT_STRING) {
         // includes an all-blank column with a string at the top; e.g. test 1870.1 and 1870.2
@@ -1916,6 +2906,7 @@ int freadMain(freadMainArgs _args) {
     args.header = true;
     pos = prevStart;
     row1line--;
+    schemaSavable = false;  // the layout depends on more than the first line
   }
 
   if (args.header==NA_BOOL8) {
@@ -1966,6 +2957,8 @@ int freadMain(freadMainArgs _args) {
     meanLineLen = (double)sumLen/sampleLines;
     estnrow = CEIL(bytesRead/meanLineLen);  // only used for progress meter and verbose line below
     double sd = sqrt( (sumLenSq - (sumLen*sumLen)/sampleLines)/(sampleLines-1) );
+    sdLineLen = sd;
+    minLineLen = minLen;
     allocnrow = clamp_szt((size_t)(bytesRead / fmax(meanLineLen - 2*sd, minLen)),
                           (size_t)(1.1*estnrow), 2*estnrow);
     // sd can be very close to 0.0 sometimes, so apply a +10% minimum
@@ -1988,6 +2981,71 @@ int freadMain(freadMainArgs _args) {
     estnrow = allocnrow = nrowLimit;
   }
   }
+  else {
+    // Schema from the cache. Its types are checked against the first jumpLines rows like jump 0 above; any other
+    // out-of-sample type exceptions are handled by the usual reread in [11].
+    if (verbose) DTPRINT(_("[07] Column types, header and line lengths from the cached schema\n"));
+    type =    (int8_t *)malloc((size_t)ncol * sizeof(int8_t));
+    tmpType = (int8_t *)malloc((size_t)ncol * sizeof(int8_t));
+    decimalScale = (int8_t *)calloc((size_t)ncol, sizeof(int8_t));
+    colDateTimeFormat = (int8_t *)malloc((size_t)ncol * 2 * sizeof(int8_t));
+    if (!type || !tmpType || !decimalScale || !colDateTimeFormat)
+      STOP(_("Failed to allocate 5 x %d bytes for type, tmpType, decimalScale and colDateTimeFormat: %s"), ncol, strerror(errno));
+    memset(colDateTimeFormat, -1, (size_t)ncol * 2);  // the layouts are found again on the first rows below
+    memcpy(type, schema.types, (size_t)ncol);
+    memcpy(tmpType, schema.types, (size_t)ncol);
+    args.header = schema.header;
+    ch = pos;
+    if (args.header) {
+      countfields(&ch);
+      row1line++;
+    }
+    const char *firstRowStart = ch;
+    bool bumped = false;
+    for (int i=0; i<jumpLines && ch<eof; i++) {
+      int thisNcol = detect_types(&ch, tmpType, colDateTimeFormat, ncol, &bumped);
+      if (thisNcol==0 && skipEmptyLines) { if (eol(&ch)) ch++; continue; }
+      if (thisNcol<ncol || (!eol(&ch) && ch!=eof)) break;
+      ch += (*ch=='\n' || *ch=='\r');
+      if (bumped) { memcpy(type, tmpType, (size_t)ncol); bumped = false; }
+    }
+    memcpy(tmpType, type, (size_t)ncol);
+    if (rowIndexUsed) {
+      // the types at the end of the read which recorded the row index already fit every row
+      memcpy(type, rowIndex.types, (size_t)ncol);
+      memcpy(tmpType, rowIndex.types, (size_t)ncol);
+      memcpy(decimalScale, rowIndex.scale, (size_t)ncol);
+      memcpy(colDateTimeFormat, rowIndex.fmt, (size_t)ncol);
+    }
+    if (verbose) DTPRINT(_("  Type codes (cached)      : %s  Quote rule %d\n"), typesAsString(ncol), quoteRule);
+    meanLineLen = schema.meanLineLen;
+    sdLineLen = schema.sdLineLen;
+    minLineLen = schema.minLineLen;
+    bytesRead = (size_t)(eof - firstRowStart);
+    estnrow = CEIL(bytesRead/meanLineLen);
+    allocnrow = clamp_szt((size_t)(bytesRead / fmax(meanLineLen - 2*sdLineLen, minLineLen)),
+                          (size_t)(1.1*estnrow), 2*estnrow);
+    // the number of sampling jump points is still what decides whether to split the read into chunks in [10]
+    size_t jump0size = (size_t)(jumpLines*meanLineLen), sz = (size_t)(eof - pos);
+    nJumps = jump0size*100*2 < sz ? 100 : (jump0size*10*2 < sz ? 10 : 1);
+    nJumps++;
+    if (nrowLimit<INT64_MAX) nJumps=1;
+    sampleLines = 0;
+    if (verbose) DTPRINT(_("  Estimated number of rows: %"PRIu64" / %.2f = %"PRIu64". Initial alloc = %"PRIu64" rows\n"),
+                         (uint64_t)bytesRead, meanLineLen, (uint64_t)estnrow, (uint64_t)allocnrow);
+    if (nrowLimit < allocnrow) estnrow = allocnrow = nrowLimit;
+  }
+  const bool buildRowIndex = args.rowIndex && !args.tail && !rowIndexUsed && nrowLimit==INT64_MAX;
+  if (buildRowIndex || args.tail) {
+    schemaTypes = (int8_t *)malloc((size_t)ncol * sizeof(int8_t));
+    if (!schemaTypes) STOP(_("Failed to allocate %d bytes for schemaTypes: %s"), ncol, strerror(errno));
+    memcpy(schemaTypes, type, (size_t)ncol);
+  }
+  if (args.schemaCache && !schemaUsed) {
+    sampleTypes = (int8_t *)malloc((size_t)ncol * sizeof(int8_t));
+    if (!sampleTypes) STOP(_("Failed to allocate %d bytes for sampleTypes: %s"), ncol, strerror(errno));
+    memcpy(sampleTypes, type, (size_t)ncol);
+  }
 
   //*********************************************************************************************
   // [8] Assign column names
@@ -2002,6 +3060,19 @@ int freadMain(freadMainArgs _args) {
 
   if (args.header==false) {
     colNames = NULL;  // userOverride will assign V1, V2, etc
+  } else if (fixedWidth) {
+    colNames = (lenOff*) calloc((size_t)ncol, sizeof(lenOff));
+    if (!colNames) STOP(_("Unable to allocate %d*%d bytes for column name pointers: %s"), ncol, sizeof(lenOff), strerror(errno));
+    const char *lineEnd = fw_line_end(ch);
+    for (int j=0; j<ncol; j++) {
+      const char *e, *s = fw_field(ch, lineEnd, j, &e);
+      while (s<e && isspace(*s)) s++;
+      while (e>s && isspace(e[-1])) e--;
+      colNames[j].len = (int32_t)(e-s);
+      colNames[j].off = (int32_t)(s-colNamesAnchor);
+    }
+    ch = lineEnd;
+    pos = (ch<eof && eol(&ch)) ? ch+1 : ch;
   } else {
     colNames = (lenOff*) calloc((size_t)ncol, sizeof(lenOff));
     if (!colNames) STOP(_("Unable to allocate %d*%d bytes for column name pointers: %s"), ncol, sizeof(lenOff), strerror(errno));
@@ -2011,6 +3082,7 @@ int freadMain(freadMainArgs _args) {
       .ch = &ch,
       .targets = targets,
       .anchor = colNamesAnchor,
+      .end = eof,
     };
     ch--;
     for (int i=0; i<ncol; i++) {
@@ -2063,7 +3135,23 @@ int freadMain(freadMainArgs _args) {
   nNonStringCols = 0;
   for (int j=0; j<ncol; j++) {
     if (type[j]==CT_DROP) { size[j]=0; ndrop++; continue; }
-    if (type[j]<tmpType[j]) {
+    if (type[j]==CT_DECIMAL && tmpType[j]<=CT_FLOAT64) {
+      // the one override allowed down: float64 to decimal, when the decimal places in the sample fit in int64
+      // leaving room for at least 3 integer digits (parse_decimal() takes 18 digits in all)
+      if (decimalScale[j]>15) {
+        DTWARN(_("Column %d%s%.*s%s has up to %d decimal places in the sample which is too many for 'decimal'; reading as '%s' instead."),
+               j+1, colNames?" <<":"", colNames?(colNames[j].len):0, colNames?(colNamesAnchor+colNames[j].off):"", colNames?">>":"",
+               decimalScale[j], typeName[CT_FLOAT64]);
+        type[j] = CT_FLOAT64;
+      } else if (verbose) {
+        DTPRINT(_("  Column %d read as decimal with %d decimal places\n"), j+1, decimalScale[j]);
+      }
+    }
+    else if ((type[j]==CT_DATE_FMT || type[j]==CT_TIME_FMT) && type[j]!=tmpType[j]) {
+      // a layout given for this column by name in dateTimeFormats applies whatever the detected type, e.g. "%Y%m%d" to an int32 column
+      if (verbose) DTPRINT(_("  Column %d read using dateTimeFormats <<%s>>\n"), j+1, args.dateTimeFormats[colDateTimeFormat[j]]);
+    }
+    else if (type[j]<tmpType[j]) {
       if (strcmp(typeName[tmpType[j]], typeName[type[j]]) != 0) {
         DTWARN(_("Attempt to override column %d%s%.*s%s of inherent type '%s' down to '%s' ignored. Only overrides to a higher type are currently supported. If this was intended, please coerce to the lower type afterwards."),
                j+1, colNames?" <<":"", colNames?(colNames[j].len):0, colNames?(colNamesAnchor+colNames[j].off):"", colNames?">>":"", // #4644
@@ -2078,7 +3166,7 @@ int freadMain(freadMainArgs _args) {
     rowSize1 += (size[j] & 1);  // only works if all sizes are powers of 2
     rowSize4 += (size[j] & 4);
     rowSize8 += (size[j] & 8);
-    if (type[j] == CT_STRING) nStringCols++; else nNonStringCols++;
+    if (type[j] >= CT_STRING) nStringCols++; else nNonStringCols++;
   }
   if (verbose) DTPRINT(_("  After %d type and %d drop user overrides : %s\n"), nUserBumped, ndrop, typesAsString(ncol));
   tColType = wallclock();
@@ -2087,8 +3175,139 @@ int freadMain(freadMainArgs _args) {
   //*********************************************************************************************
   // [10] Allocate the result columns
   //*********************************************************************************************
+  // chunkBytes is the distance between each jump point; it decides the number of jumps
+  // We may want each chunk to write to its own page of the final column, hence 1000*maxLen
+  // For the 44GB file with 12875 columns, the max line len is 108,497. We may want each chunk to write to its
+  // own page (4k) of the final column, hence 1000 rows of the smallest type (4 byte int) is just
+  // under 4096 to leave space for R's header + malloc's header.
+  // nrows= on its own reads single-threaded up to nrowLimit. When there are many rows to read, the end of the first nrowLimit
+  // lines is found with all threads instead and those bytes (which hold at most nrowLimit rows) are read in parallel like
+  // a whole file. If they turn out to hold fewer rows, due to newlines inside quoted fields or blank lines, the rest are
+  // read single-threaded after them as before.
+  const char *readEnd = eof;
+  if (rowIndexUsed && args.tail) {
+    // The rows appended since the previous read, which stopped at offset[0]. There are few so the newlines are counted
+    // for the allocation; newlines inside quoted fields only make that an over-estimate.
+    pos = sof + rowIndex.offset[0];
+    if (pos>eof) pos = eof;  // no complete line has been appended; eof is on the final \n of the previous read
+    bytesRead = (size_t)(eof-pos);
+    estnrow = allocnrow = pos<eof ? (int64_t)count_newlines(pos, eof)+1 : 0;
+    if (allocnrow) meanLineLen = (double)bytesRead/allocnrow;
+    nJumps = 3;  // split into chunks below
+    if (verbose) DTPRINT(_("  tail=TRUE: reading the %"PRIu64" bytes appended from byte %"PRId64"\n"), (uint64_t)bytesRead, rowIndex.offset[0]);
+  }
+  else if (rowIndexUsed) {
+    // Rows [firstRow, firstRow+nrowLimit) using the row index: start from the last recorded row at or before firstRow and walk
+    // the few rows after it, then read up to the last recorded row at or before the end in parallel. The rows after that
+    // are read on from there single-threaded, as for nrows= below.
+    const int64_t firstRow = args.firstRow, *row = rowIndex.row;
+    if (firstRow<0 || firstRow>rowIndex.nrow)
+      STOP(_("Row %"PRId64" was requested but the row index has %"PRId64" rows"), firstRow+1, rowIndex.nrow);
+    const int64_t lastRow = nrowLimit < rowIndex.nrow-firstRow ? firstRow+nrowLimit : rowIndex.nrow;
+    int64_t lo=0, hi=rowIndex.n-1;  // the last entry with row<=firstRow; row[0]==0
+    while (lo<hi) { int64_t mid = lo+(hi-lo+1)/2; if (row[mid]<=firstRow) lo=mid; else hi=mid-1; }
+    ch = sof + rowIndex.offset[lo];
+    for (int64_t r=row[lo]; r<firstRow && ch<eof;) {
+      int thisNcol = countfields(&ch);
+      if (thisNcol<0) STOP(_("Row %"PRId64" could not be found using the row index. Please remove the row index file so that it is built again."), r+1);
+      if (thisNcol==0 && skipEmptyLines) continue;
+      r++;
+    }
+    pos = ch;
+    if (lastRow<rowIndex.nrow) {
+      hi = rowIndex.n-1;  // the last entry with row<=lastRow
+      while (lo<hi) { int64_t mid = lo+(hi-lo+1)/2; if (row[mid]<=lastRow) lo=mid; else hi=mid-1; }
+      readEnd = row[lo]>firstRow ? sof + rowIndex.offset[lo] : pos;
+    }
+    bytesRead = (size_t)(readEnd-pos);
+    estnrow = allocnrow = lastRow-firstRow;
+    if (allocnrow) meanLineLen = (double)bytesRead/allocnrow;
+    nJumps = 3;  // split into chunks below
+    if (verbose) DTPRINT(_("  Rows %"PRId64" to %"PRId64" found using the row index; reading %"PRIu64" bytes of them in parallel\n"),
+                         firstRow+1, lastRow, (uint64_t)bytesRead);
+  }
+  else if (nrowLimit<INT64_MAX && nrowLimit>SKIP_PARALLEL_MIN && nth>1 && args.batchRows<=0 && pos<eof) {
+    uint64_t found = 0;
+    const char *end = skip_lines_parallel(pos, eof, (uint64_t)nrowLimit, nth, &found);
+    if (end && end<eof) {
+      readEnd = end;
+      bytesRead = (size_t)(readEnd-pos);
+      meanLineLen = (double)bytesRead/nrowLimit;
+      estnrow = allocnrow = nrowLimit;
+      nJumps = 3;  // split into chunks below
+      if (verbose) DTPRINT(_("  nrows=%"PRIu64" found to end %"PRIu64" bytes after the first row using %d threads; reading those in parallel\n"),
+                           (uint64_t)nrowLimit, (uint64_t)bytesRead, nth);
+    }
+  }
+  size_t chunkBytes = umax((size_t)(1000*meanLineLen), 1ULL/*MB*/ *1024*1024);
+  int batchJumps;  // number of jumps in each window when streaming (args.batchRows>0); otherwise all jumps are one window
+  if (nJumps/*from sampling*/>2) {
+    // streaming: a window of batchRows should still give each thread at least one chunk; but keep chunks to at least 100 lines
+    size_t windowBytes = (size_t)(args.batchRows*meanLineLen);
+    if (args.batchRows>0) chunkBytes = umin(chunkBytes, umax(windowBytes/nth, (size_t)(100*meanLineLen)));
+    // ensure data size is split into same sized chunks (no remainder in last chunk) and a multiple of nth
+    // when nth==1 we still split by chunk for consistency (testing) and code sanity
+    nJumps = (int)(bytesRead/chunkBytes);
+    if (nJumps==0) nJumps=1;
+    else if (nJumps>nth) nJumps = nth*(1+(nJumps-1)/nth);
+    chunkBytes = bytesRead / (size_t)nJumps;
+    batchJumps = args.batchRows>0 ? (int)clamp_szt((int64_t)((windowBytes+chunkBytes/2)/chunkBytes), 1, nJumps) : nJumps;
+  } else {
+    ASSERT(nJumps==1 /*when nrowLimit supplied*/ || nJumps==2 /*small files*/, "nJumps (%d) != 1|2", nJumps);
+    nJumps=1;
+    batchJumps=1;
+  }
+  if (batchJumps<nJumps) allocnrow = CEIL((double)allocnrow*batchJumps/nJumps);  // grown later if a window turns out to have more rows
+  if (verbose) DTPRINT(_("[10] Allocate memory for the datatable\n"));
+  int slotsPerThread = 4;  // chunk buffers per thread; see the waves in [11]
+  if (args.memoryLimit>0 || verbose) {
+    // Estimate the peak memory of the read up front: the columns at allocnrow rows, the characters of the strings, the chunk
+    // buffers of a wave, and the copy of the input when it was decompressed or read from a pipe rather than mapped. A string
+    // is a pointer in its column plus a CHARSXP of about 48 bytes and its characters, taking every string as different.
+    double rowBytes = 0, strBytes = 0;
+    int nStr = 0;
+    for (int j=0; j<ncol; j++) {
+      if (type[j]==CT_DROP) continue;
+      rowBytes += type[j]==CT_STRING ? 8 : (type[j]==CT_FACTOR || typeSize[type[j]]<4 ? 4 : typeSize[type[j]]);  // R's logical is 4 bytes
+      nStr += type[j]>=CT_STRING;
+    }
+    strBytes = nStr * (48 + meanLineLen/ncol);
+    const double slotRowBytes = (double)(rowSize1 + rowSize4 + rowSize8);
+    const double inputBytes = mmp_copy ? (double)fileSize : 0.0;
+    const double windowRows = (double)estnrow*batchJumps/nJumps;
+    int memNth = imin(nJumps, nth);
+    double colPeak, slotPeak, peak;
+    int nSlots;
+    for (;;) {
+      nSlots = memNth==1 ? 1 : imin(slotsPerThread*memNth, batchJumps);
+      colPeak = (double)allocnrow * (rowBytes + strBytes);
+      slotPeak = (double)nSlots * umax(allocnrow/batchJumps, 10) * slotRowBytes;
+      peak = colPeak + slotPeak + inputBytes;
+      if (args.memoryLimit==0 || peak<=(double)args.memoryLimit) break;
+      // Over budget. Allocate rows only 5% over the estimate rather than for the line lengths varying (the columns are grown
+      // if that's too few), then hold fewer chunks per wave, then use fewer threads
+      if (allocnrow > 1.05*windowRows+1) allocnrow = (size_t)(1.05*windowRows)+1;
+      else if (slotsPerThread>1) slotsPerThread = 1;
+      else if (memNth>1) memNth /= 2;
+      else break;
+    }
+    if (verbose) {
+      DTPRINT(_("  Estimated peak memory %.1fMB: %.1fMB for %"PRIu64" rows of %d columns (%d of strings), %.1fMB for %d chunk buffers (up to %d per thread), %.1fMB for the input\n"),
+              peak/1048576, colPeak/1048576, (uint64_t)allocnrow, ncol-ndrop, nStr, slotPeak/1048576, nSlots, memNth==1 ? 1 : slotsPerThread, inputBytes/1048576);
+    }
+    if (args.memoryLimit>0 && peak>(double)args.memoryLimit) {
+      STOP(_("Reading this input needs an estimated %.1fMB (%.1fMB for %"PRIu64" rows of %d columns, %.1fMB for chunk buffers, %.1fMB for the input) which is more than memoryLimit=%.1fMB. Read fewer columns with select= or drop=, fewer rows with nrows=, or %s."),
+           peak/1048576, colPeak/1048576, (uint64_t)allocnrow, ncol-ndrop, slotPeak/1048576, inputBytes/1048576, (double)args.memoryLimit/1048576,
+           args.batchRows>0 ? _("smaller batches with batchRows=") : _("in batches with callback="));
+    }
+    if (memNth<imin(nJumps, nth)) {
+      if (verbose) DTPRINT(_("  Using %d threads rather than %d to fit memoryLimit\n"), memNth, imin(nJumps, nth));
+      nth = memNth;
+    }
+  }
   if (verbose) {
-    DTPRINT(_("[10] Allocate memory for the datatable\n"));
+    if (batchJumps<nJumps) DTPRINT(_("  Streaming in windows of %d chunks of the %d in total (about %"PRIu64" rows each)\n"),
+                                   batchJumps, nJumps, (uint64_t)(estnrow*batchJumps/nJumps));
     DTPRINT(_("  Allocating %d column slots (%d - %d dropped) with %"PRIu64" rows\n"),
             ncol-ndrop, ncol, ndrop, (uint64_t)allocnrow);
   }
@@ -2109,34 +3328,26 @@ int freadMain(freadMainArgs _args) {
   int64_t DTi = 0;                  // the current row number in DT that we are writing to
   const char *headPos = pos;       // the jump start corresponding to DTi
   int nSwept = 0;                  // count the number of dirty jumps that were swept
+  int nKept = 0;                   // count the chunks after a dirty jump that were kept and accepted rather than read again
   const char *quoteRuleBumpedCh = NULL;   // in the very rare event of an out-of-sample quote rule bump, give a good warning message
   int64_t quoteRuleBumpedLine = -1;
+  int bumpJump = -1;               // the wave the first out-of-sample type bump was found in starts at this jump, headPos and DTi.
+  const char *bumpPos = NULL;      // Rows before it were pushed at the types the read started with (tmpType) and can be kept
+  int64_t bumpDTi = 0;             // when all bumps widen those types; see widenable()
   int buffGrown=0;
-  // chunkBytes is the distance between each jump point; it decides the number of jumps
-  // We may want each chunk to write to its own page of the final column, hence 1000*maxLen
-  // For the 44GB file with 12875 columns, the max line len is 108,497. We may want each chunk to write to its
-  // own page (4k) of the final column, hence 1000 rows of the smallest type (4 byte int) is just
-  // under 4096 to leave space for R's header + malloc's header.
-  size_t chunkBytes = umax((size_t)(1000*meanLineLen), 1ULL/*MB*/ *1024*1024);
   // Index of the first jump to read. May be modified if we ever need to restart
   // reading from the middle of the file.
   int jump0 = 0;
+  // The window of jumps [windowJump0, jumpEnd) being read. Only when streaming is this not all the jumps.
+  int windowJump0 = 0, jumpEnd = batchJumps;
+  const char *windowPos = pos;     // headPos at the start of the window, for rereading it after a type bump when streaming
+  int64_t rowsBefore = 0;          // rows passed to consumeBatch() in previous windows when streaming
+  bool stoppedEarly = false, userStopped = false;
   // If we need to restart reading the file because we ran out of allocation
   // space, then this variable will tell how many new rows has to be allocated.
   int64_t extraAllocRows = 0;
 
-  if (nJumps/*from sampling*/>2) {
-    // ensure data size is split into same sized chunks (no remainder in last chunk) and a multiple of nth
-    // when nth==1 we still split by chunk for consistency (testing) and code sanity
-    nJumps = (int)(bytesRead/chunkBytes);
-    if (nJumps==0) nJumps=1;
-    else if (nJumps>nth) nJumps = nth*(1+(nJumps-1)/nth);
-    chunkBytes = bytesRead / (size_t)nJumps;
-  } else {
-    ASSERT(nJumps==1 /*when nrowLimit supplied*/ || nJumps==2 /*small files*/, "nJumps (%d) != 1|2", nJumps);
-    nJumps=1;
-  }
-  int64_t initialBuffRows = (int64_t)allocnrow / nJumps;
+  int64_t initialBuffRows = (int64_t)allocnrow / batchJumps;  // allocnrow covers one window of jumps when streaming
 
   // Catch initialBuffRows==0 when max_nrows is small, seg fault #2243
   // Rather than 10, maybe 1 would work too but then 1.5 grow factor * 1 would still be 1. This clamp
@@ -2146,43 +3357,41 @@ int freadMain(freadMainArgs _args) {
   if (initialBuffRows > INT32_MAX) STOP(_("Buffer size %"PRId64" is too large\n"), (int64_t)initialBuffRows);
   nth = imin(nJumps, nth);
 
+  dropRun = (int *)malloc(((size_t)ncol+1) * sizeof(int));
+  if (!dropRun) STOP(_("Failed to allocate %d ints for dropRun"), ncol+1);  // # nocov
+  dropRun[ncol] = 0;
+  for (int j=ncol-1; j>=0; j--) dropRun[j] = type[j]==CT_DROP ? dropRun[j+1]+1 : 0;
+
+  memcpy(tmpType, type, (size_t)ncol);  // tmpType is free to reuse after the user overrides
   if (verbose) DTPRINT(_("[11] Read the data\n"));
   read:  // we'll return here to reread any columns with out-of-sample type exceptions, or dirty jumps
   restartTeam = false;
   if (verbose) DTPRINT(_("  jumps=[%d..%d), chunk_size=%"PRIu64", total_size=%"PRIu64"\n"),
-                       jump0, nJumps, (uint64_t)chunkBytes, (uint64_t)(eof-pos));
+                       jump0, jumpEnd, (uint64_t)chunkBytes, (uint64_t)(eof-pos));
   ASSERT(allocnrow <= nrowLimit, "allocnrow(%"PRIu64") <= nrowLimit(%"PRIu64")", (uint64_t)allocnrow, (uint64_t)nrowLimit);
-  #pragma omp parallel num_threads(nth)
-  {
-    int me = omp_get_thread_num();
-    bool myShowProgress = false;
-    #pragma omp master
-    {
-      nth = omp_get_num_threads();
-      if (me!=0) {
-        // # nocov start
-        snprintf(internalErr, internalErrSize, _("Internal error: Master thread is not thread 0 but thread %d.\n"), me);
-        stopTeam = true;
-        // # nocov end
-      }
-      myShowProgress = args.showProgress;
-    }
-    int64_t myNrow = 0; // the number of rows in my chunk
-    int64_t myBuffRows = initialBuffRows;  // Upon realloc, myBuffRows will increase to grown capacity
-    bool myStopEarly = false;      // true when an empty or too-short line is encountered when fill=false, or too-long row
-
-    // Allocate thread-private row-major `myBuff`s
-    ThreadLocalFreadParsingContext ctx = {
+  // Chunks are read in waves of up to nSlots jumps. Each jump of a wave is parsed by any thread into its own slot. Then the
+  // master walks the wave in jump order, which is cheap as it only adds up row counts to assign each slot its rows in DT
+  // (and checks the slot started where the previous one ended). Then all threads push the accepted slots to DT concurrently.
+  // No thread waits in turn for the one before it, as happened with an ordered section when chunk parse times vary. The slots
+  // keep their buffers from wave to wave, so memory is bounded by the wave size rather than growing with the file. When
+  // single-threaded, a wave is one jump so that DTi is up to date for nrowLimit. Jump j's slot is slots[j%nSlots], so a
+  // slot kept after a dirty jump (see Phase 2) is in place for the next wave.
+  int nSlots = nth==1 ? 1 : imin(slotsPerThread*nth, jumpEnd-jump0);
+  ChunkSlot *slots = calloc((size_t)nSlots, sizeof(ChunkSlot));
+  if (!slots) STOP(_("Failed to allocate %d chunk buffers for reading"), nSlots);  // # nocov
+  for (int i=0; i<nSlots; i++) {
+    slots[i].buffRows = initialBuffRows;
+    slots[i].ctx = (ThreadLocalFreadParsingContext){
       .anchor = NULL,
-      .buff8 = malloc(rowSize8 * myBuffRows + 8),
-      .buff4 = malloc(rowSize4 * myBuffRows + 4),
-      .buff1 = malloc(rowSize1 * myBuffRows + 1),
+      .buff8 = malloc(rowSize8 * initialBuffRows + 8),
+      .buff4 = malloc(rowSize4 * initialBuffRows + 4),
+      .buff1 = malloc(rowSize1 * initialBuffRows + 1),
       .rowSize8 = rowSize8,
       .rowSize4 = rowSize4,
       .rowSize1 = rowSize1,
-      .DTi = 0,  // which row in the final DT result I should start writing my chunk to
+      .DTi = 0,  // which row in the final DT result this chunk is written to; assigned by the master once earlier chunks are counted
       .nRows = allocnrow,
-      .threadn = me,
+      .threadn = 0,
       .quoteRule = quoteRule,
       .stopTeam = &stopTeam,
       #ifndef DTPY
@@ -2190,301 +3399,415 @@ int freadMain(freadMainArgs _args) {
       .nNonStringCols = nNonStringCols
       #endif
     };
-    if ((rowSize8 && !ctx.buff8) || (rowSize4 && !ctx.buff4) || (rowSize1 && !ctx.buff1)) {
+    ThreadLocalFreadParsingContext *ctx = &slots[i].ctx;
+    if ((rowSize8 && !ctx->buff8) || (rowSize4 && !ctx->buff4) || (rowSize1 && !ctx->buff1)) {
       stopTeam = true;
     }
-    prepareThreadContext(&ctx);
-
-    #pragma omp for ordered schedule(dynamic) reduction(+:thRead,thPush)
-    for (int jump = jump0; jump < nJumps; jump++) {
-      if (stopTeam) continue;  // must continue and not break. We desire not to depend on (relatively new) omp cancel directive, yet
-      double tLast = 0.0;      // thread local wallclock time at last measuring point for verbose mode only.
-      if (verbose) tLast = wallclock();
-      if (myNrow) {
-        // On the 2nd iteration onwards for this thread, push the data from the previous jump
-        // Convoluted because the ordered section has to be last in some OpenMP implementations :
-        // http://stackoverflow.com/questions/43540605/must-ordered-be-at-the-end
-        // Hence why loop goes to nJumps+nth. Logically, this clause belongs after the ordered section.
-
-        // Push buffer now to impl so that :
-        //   i) lenoff.off can be "just" 32bit int from a local anchor rather than a 64bit offset from a global anchor
-        //  ii) impl can do it in parallel if it wishes, and it can have an orphan critical directive if it wishes
-        // iii) myBuff is hot, so this is the best time to transpose it to result, and first time possible as soon
-        //      as we know the previous jump's number of rows.
-        //  iv) so that myBuff can be small
-        pushBuffer(&ctx);
-        myNrow = 0;
-        if (verbose || myShowProgress) {
-          double now = wallclock();
-          thPush += now-tLast;
-          tLast = now;
-          if (myShowProgress && /*wait for all threads to process 2 jumps*/jump>=nth*2) {
-            // Important for thread safety inside progess() that this is called not just from critical but that
-            // it's the master thread too, hence me==0. OpenMP doesn't allow '#pragma omp master' here, but we
-            // did check above that master's me==0.
-            int ETA = (int)(((now-tAlloc)/jump) * (nJumps-jump));
-            progress((int)(100.0*jump/nJumps), ETA);
-          }
-        }
+    prepareThreadContext(ctx);
+  }
+  int wave0 = jump0, waveEnd = imin(jump0+nSlots, jumpEnd);  // the wave of jumps [wave0, waveEnd) being read
+  int nPush = 0;                   // the first nPush jumps of the wave were accepted by the master and are pushed to DT
+  int push0 = 0;                   // the first of those jumps
+  bool readDone = stopTeam || wave0>=jumpEnd;
+  #pragma omp parallel num_threads(nth)
+  {
+    int me = omp_get_thread_num();
+    bool myShowProgress = false;
+    #pragma omp master
+    {
+      nth = omp_get_num_threads();
+      if (me!=0) {
+        // # nocov start
+        snprintf(internalErr, internalErrSize, _("Internal error: Master thread is not thread 0 but thread %d.\n"), me);
+        stopTeam = readDone = true;
+        // # nocov end
       }
+      myShowProgress = args.showProgress;
+    }
+    #pragma omp barrier
+
+    while (!readDone) {
+      // Phase 1: parse each jump of the wave into its slot, in any order
+      #pragma omp for schedule(dynamic) reduction(+:thRead)
+      for (int jump = wave0; jump < waveEnd; jump++) {
+        ChunkSlot *slot = &slots[jump%nSlots];
+        if (stopTeam || slot->kept) continue;  // must continue and not break. We desire not to depend on (relatively new) omp cancel directive, yet
+        double tLast = 0.0;      // thread local wallclock time at last measuring point for verbose mode only.
+        if (verbose) tLast = wallclock();
+        ThreadLocalFreadParsingContext ctx = slot->ctx;
+        ctx.threadn = me;
+        int64_t myNrow = 0; // the number of rows in my chunk
+        int64_t myBuffRows = slot->buffRows;
+        bool myStopEarly = false;
+
+        const char *tch = jump==wave0 ? headPos : nextGoodLine(pos+(size_t)jump*chunkBytes, ncol);
+        const char *thisJumpStart = tch;   // "this" for prev/this/next adjective used later, rather than a (mere) t prefix for thread-local.
+        const char *tLineStart = tch;
+        const char *nextJumpStart = jump<nJumps-1 ? nextGoodLine(pos+(size_t)(jump+1)*chunkBytes, ncol) : readEnd;
+
+        void *targets[9] = {NULL, ctx.buff1, NULL, NULL, ctx.buff4, NULL, NULL, NULL, ctx.buff8};
+        FieldParseContext fctx = {
+          .ch = &tch,
+          .targets = targets,
+          .anchor = thisJumpStart,
+          .end = eof,
+        };
+
+        while (tch<nextJumpStart && (nth>1 || DTi+myNrow<nrowLimit)) {  // setting nrowLimit sets nth to 1 to avoid bump or error on row after nrowLimit
+          if (myNrow == myBuffRows) {
+            // buffer full due to unusually short lines in this chunk vs the sample; e.g. #2070
+            myBuffRows *= 1.5;
+            #pragma omp atomic
+            buffGrown++;
+            ctx.buff8 = realloc(ctx.buff8, rowSize8 * myBuffRows + 8);
+            ctx.buff4 = realloc(ctx.buff4, rowSize4 * myBuffRows + 4);
+            ctx.buff1 = realloc(ctx.buff1, rowSize1 * myBuffRows + 1);
+            if ((rowSize8 && !ctx.buff8) || (rowSize4 && !ctx.buff4) || (rowSize1 && !ctx.buff1)) {
+              stopTeam = true;
+              break;
+            }
+            // shift current buffer positions, since `myBuffX`s were probably moved by realloc
+            fctx.targets[8] = (void*)((char*)ctx.buff8 + myNrow * rowSize8);
+            fctx.targets[4] = (void*)((char*)ctx.buff4 + myNrow * rowSize4);
+            fctx.targets[1] = (void*)((char*)ctx.buff1 + myNrow * rowSize1);
+          }
+          tLineStart = tch;  // for error message
+          const char *fieldStart = tch;
+          int j = 0;
 
-      const char *tch = jump==jump0 ? headPos : nextGoodLine(pos+(size_t)jump*chunkBytes, ncol);
-      const char *thisJumpStart = tch;   // "this" for prev/this/next adjective used later, rather than a (mere) t prefix for thread-local.
-      const char *tLineStart = tch;
-      const char *nextJumpStart = jump<nJumps-1 ? nextGoodLine(pos+(size_t)(jump+1)*chunkBytes, ncol) : eof;
-
-      void *targets[9] = {NULL, ctx.buff1, NULL, NULL, ctx.buff4, NULL, NULL, NULL, ctx.buff8};
-      FieldParseContext fctx = {
-        .ch = &tch,
-        .targets = targets,
-        .anchor = thisJumpStart,
-      };
-
-      while (tch<nextJumpStart && (nth>1 || DTi+myNrow<nrowLimit)) {  // setting nrowLimit sets nth to 1 to avoid bump or error on row after nrowLimit
-        if (myNrow == myBuffRows) {
-          // buffer full due to unusually short lines in this chunk vs the sample; e.g. #2070
-          myBuffRows *= 1.5;
-          #pragma omp atomic
-          buffGrown++;
-          ctx.buff8 = realloc(ctx.buff8, rowSize8 * myBuffRows + 8);
-          ctx.buff4 = realloc(ctx.buff4, rowSize4 * myBuffRows + 4);
-          ctx.buff1 = realloc(ctx.buff1, rowSize1 * myBuffRows + 1);
-          if ((rowSize8 && !ctx.buff8) || (rowSize4 && !ctx.buff4) || (rowSize1 && !ctx.buff1)) {
-            stopTeam = true;
-            break;
+          const char *lineEnd = NULL, *fieldEnd = NULL;  // fixed-width input only; its fields are parsed in the cold loop below
+          if (fixedWidth) {
+            lineEnd = fw_line_end(tch);
+            skip_white(&tch);
+            if (tch==eof) continue;  // empty last line
+            if (tch==lineEnd && eol(&tch) && skipEmptyLines) { tch++; continue; }
+            tch = tLineStart;
           }
-          // shift current buffer positions, since `myBuffX`s were probably moved by realloc
-          fctx.targets[8] = (void*)((char*)ctx.buff8 + myNrow * rowSize8);
-          fctx.targets[4] = (void*)((char*)ctx.buff4 + myNrow * rowSize4);
-          fctx.targets[1] = (void*)((char*)ctx.buff1 + myNrow * rowSize1);
-        }
-        tLineStart = tch;  // for error message
-        const char *fieldStart = tch;
-        int j = 0;
-
-        //*** START HOT ***//
-        if (sep!=' ' && !any_number_like_NAstrings) {  // TODO:  can this 'if' be dropped somehow? Can numeric NAstrings be dealt with afterwards in one go as numeric comparison?
-          // Try most common and fastest branch first: no whitespace, no quoted numeric, ",," means NA
-          while (j < ncol) {
-            // DTPRINT(_("Field %d: '%.10s' as type %d  (tch=%p)\n"), j+1, tch, type[j], tch);
-            fieldStart = tch;
-            int8_t thisType = type[j];  // fetch shared type once. Cannot read half-written byte is one reason type's type is single byte to avoid atomic read here.
-            fun[abs(thisType)](&fctx);
-            if (*tch!=sep) break;
-            int8_t thisSize = size[j];
-            if (thisSize) ((char **) targets)[thisSize] += thisSize;  // 'if' for when rereading to avoid undefined NULL+0
-            tch++;
-            j++;
+          //*** START HOT ***//
+          else if (sep!=' ' && !any_number_like_NAstrings) {  // TODO:  can this 'if' be dropped somehow? Can numeric NAstrings be dealt with afterwards in one go as numeric comparison?
+            // Try most common and fastest branch first: no whitespace, no quoted numeric, ",," means NA
+            while (j < ncol) {
+              // DTPRINT(_("Field %d: '%.10s' as type %d  (tch=%p)\n"), j+1, tch, type[j], tch);
+              if (dropRun[j]>1) j += skip_fields(&tch, dropRun[j]-1);  // leaves the last dropped column in the run to Field() which finds its sep|eol
+              fieldStart = tch;
+              int8_t thisType = type[j];  // fetch shared type once. Cannot read half-written byte is one reason type's type is single byte to avoid atomic read here.
+              fctx.scale = decimalScale[j];  // only used by parse_decimal(); cheaper than a branch on type here
+              fctx.fmt = colDateTimeFormat[j];
+              fun[abs(thisType)](&fctx);
+              if (*tch!=sep) break;
+              int8_t thisSize = size[j];
+              if (thisSize) ((char **) targets)[thisSize] += thisSize;  // 'if' for when rereading to avoid undefined NULL+0
+              tch++;
+              j++;
+            }
+            //*** END HOT. START TEPID ***//
+            if (tch==tLineStart) {
+              skip_white(&tch);       // skips \0 before eof
+              if (*tch=='\0') break;  // empty last line
+              if (eol(&tch) && skipEmptyLines) { tch++; continue; }
+              tch = tLineStart;  // in case white space at the beginning may need to be including in field
+            }
+            else if (eol(&tch) && j<ncol) {   // j<ncol needed for #2523 (erroneous extra comma after last field)
+              int8_t thisSize = size[j];
+              if (thisSize) ((char **) targets)[thisSize] += thisSize;
+              j++;
+              if (j==ncol) { tch++; myNrow++; continue; }  // next line. Back up to while (tch<nextJumpStart). Usually happens, fastest path
+            }
+            else {
+              tch = fieldStart; // restart field as int processor could have moved to A in ",123A,"
+            }
+            // if *tch=='\0' then *eof in mind, fall through to below
           }
-          //*** END HOT. START TEPID ***//
-          if (tch==tLineStart) {
-            skip_white(&tch);       // skips \0 before eof
-            if (*tch=='\0') break;  // empty last line
+          //*** END TEPID. NOW COLD.
+
+          // Either whitespace surrounds field in which case the processor will fault very quickly, it's numeric but quoted (quote will fault the non-string processor),
+          // it contains an NA string, or there's an out-of-sample type bump needed.
+          // In all those cases we're ok to be a bit slower. The rest of this line will be processed using the slower version.
+          // (End-of-file) is also dealt with now, as could be the highly unusual line ending /n/r
+          // This way (each line has new opportunity of the fast path) if only a little bit of the file is quoted (e.g. just when commas are present as fwrite does)
+          // then a penalty isn't paid everywhere.
+          // TODO: reduce(slowerBranch++). So we can see in verbose mode if this is happening too much.
+
+          if (sep==' ') {
+            while (*tch==' ') tch++;  // multiple sep=' ' at the tLineStart does not mean sep. We're at tLineStart because the fast branch above doesn't run when sep=' '
+            fieldStart = tch;
+            skip_white(&tch);          // skips \0 before eof
+            if (*tch=='\0') continue;  // tch==eof; empty last line
             if (eol(&tch) && skipEmptyLines) { tch++; continue; }
-            tch = tLineStart;  // in case white space at the beginning may need to be including in field
-          }
-          else if (eol(&tch) && j<ncol) {   // j<ncol needed for #2523 (erroneous extra comma after last field)
-            int8_t thisSize = size[j];
-            if (thisSize) ((char **) targets)[thisSize] += thisSize;
-            j++;
-            if (j==ncol) { tch++; myNrow++; continue; }  // next line. Back up to while (tch<nextJumpStart). Usually happens, fastest path
-          }
-          else {
-            tch = fieldStart; // restart field as int processor could have moved to A in ",123A,"
+            tch = fieldStart;         // in case tabs at the beginning of the first field need to be included
           }
-          // if *tch=='\0' then *eof in mind, fall through to below
-        }
-        //*** END TEPID. NOW COLD.
-
-        // Either whitespace surrounds field in which case the processor will fault very quickly, it's numeric but quoted (quote will fault the non-string processor),
-        // it contains an NA string, or there's an out-of-sample type bump needed.
-        // In all those cases we're ok to be a bit slower. The rest of this line will be processed using the slower version.
-        // (End-of-file) is also dealt with now, as could be the highly unusual line ending /n/r
-        // This way (each line has new opportunity of the fast path) if only a little bit of the file is quoted (e.g. just when commas are present as fwrite does)
-        // then a penalty isn't paid everywhere.
-        // TODO: reduce(slowerBranch++). So we can see in verbose mode if this is happening too much.
-
-        if (sep==' ') {
-          while (*tch==' ') tch++;  // multiple sep=' ' at the tLineStart does not mean sep. We're at tLineStart because the fast branch above doesn't run when sep=' '
-          fieldStart = tch;
-          skip_white(&tch);          // skips \0 before eof
-          if (*tch=='\0') continue;  // tch==eof; empty last line
-          if (eol(&tch) && skipEmptyLines) { tch++; continue; }
-          tch = fieldStart;         // in case tabs at the beginning of the first field need to be included
-        }
-        bool checkedNumberOfFields = false;
-        if (fill || ncol==1 || (*tch!='\n' && *tch!='\r')) while (j < ncol) {
-          fieldStart = tch;
-          int8_t joldType = type[j];
-          int8_t thisType = joldType;  // to know if it was bumped in (rare) out-of-sample type exceptions
-          int8_t absType = (int8_t)abs(thisType);
-
-          while (absType < NUMTYPE) {
-            tch = fieldStart;
-            bool quoted = false;
-            if (absType<CT_STRING && absType>CT_DROP/*Field() too*/) {
-              skip_white(&tch);
-              const char *afterSpace = tch;
-              tch = end_NA_string(tch);
+          bool checkedNumberOfFields = false;
+          if (fill || ncol==1 || (*tch!='\n' && *tch!='\r')) while (j < ncol) {
+            fieldStart = fixedWidth ? fw_field(tLineStart, lineEnd, j, &fieldEnd) : tch;
+            int8_t joldType = type[j];
+            int8_t thisType = joldType;  // to know if it was bumped in (rare) out-of-sample type exceptions
+            int8_t absType = (int8_t)abs(thisType);
+            int8_t thisFmt = colDateTimeFormat[j];  // the layout for CT_DATE_FMT and CT_TIME_FMT; chosen afresh when bumped into one
+
+            while (absType < NUMTYPE) {
+              if (fixedWidth) {
+                fctx.scale = decimalScale[j];
+                fctx.fmt = thisFmt;
+                tch = fieldEnd;
+                if (fw_parse(&fctx, absType, fieldStart, fieldEnd)) break;
+                goto typebump;
+              }
+              tch = fieldStart;
+              bool quoted = false;
+              if (absType<CT_STRING && absType>CT_DROP/*Field() too*/) {
+                skip_white(&tch);
+                const char *afterSpace = tch;
+                tch = end_NA_string(tch);
+                skip_white(&tch);
+                if (!end_of_field(tch)) tch = afterSpace; // else it is the field_end, we're on closing sep|eol and we'll let processor write appropriate NA as if field was empty
+                if (*tch==quote && quote) { quoted=true; tch++; }
+              } // else Field() handles NA inside it unlike other processors e.g. ,, is interpretted as "" or NA depending on option read inside Field()
+              fctx.scale = decimalScale[j];
+              fctx.fmt = thisFmt;
+              fun[abs(thisType)](&fctx);
+              if (quoted) {   // quoted was only set to true with '&& quote' above (=> quote!='\0' now)
+                if (*tch==quote) tch++;
+                else goto typebump;
+              }
               skip_white(&tch);
-              if (!end_of_field(tch)) tch = afterSpace; // else it is the field_end, we're on closing sep|eol and we'll let processor write appropriate NA as if field was empty
-              if (*tch==quote && quote) { quoted=true; tch++; }
-            } // else Field() handles NA inside it unlike other processors e.g. ,, is interpretted as "" or NA depending on option read inside Field()
-            fun[abs(thisType)](&fctx);
-            if (quoted) {   // quoted was only set to true with '&& quote' above (=> quote!='\0' now)
-              if (*tch==quote) tch++;
-              else goto typebump;
-            }
-            skip_white(&tch);
-            if (end_of_field(tch)) {
-              if (sep==' ' && *tch==' ') {
-                while (tch[1]==' ') tch++;  // multiple space considered one sep so move to last
-                if (tch[1]=='\r' || tch[1]=='\n' || tch+1==eof) tch++;
+              if (end_of_field(tch)) {
+                if (sep==' ' && *tch==' ') {
+                  while (tch[1]==' ') tch++;  // multiple space considered one sep so move to last
+                  if (tch[1]=='\r' || tch[1]=='\n' || tch+1==eof) tch++;
+                }
+                break;
               }
-              break;
-            }
-
-            // guess is insufficient out-of-sample, type is changed to negative sign and then bumped. Continue to
-            // check that the new type is sufficient for the rest of the column (and any other columns also in out-of-sample bump status) to be
-            // sure a single re-read will definitely work.
-            typebump:
-            while (++absType<CT_STRING && disabled_parsers[absType]) {};
-            thisType = -absType;
-            tch = fieldStart;
-          }
 
-          if (thisType != joldType) {             // rare out-of-sample type exception.
-            if (!checkedNumberOfFields && !fill) {
-              // check this line has the correct number of fields. If not, don't apply the bump from this invalid line. Instead fall through to myStopEarly below.
-              const char *tt = fieldStart;
-              int fieldsRemaining = countfields(&tt);
-              if (j+fieldsRemaining != ncol) break;
-              checkedNumberOfFields = true;
-            }
-            if (thisType <= -NUMTYPE) {
-              break;  // Improperly quoted char field needs to be healed below, other columns will be filled #5041 and #4774
+              // guess is insufficient out-of-sample, type is changed to negative sign and then bumped. Continue to
+              // check that the new type is sufficient for the rest of the column (and any other columns also in out-of-sample bump status) to be
+              // sure a single re-read will definitely work.
+              typebump:
+              if ((absType==CT_DATE_FMT || absType==CT_TIME_FMT) && absType!=abs(joldType)) {
+                // a layout this bump chose: try the remaining layouts of its kind before the next type, as detect_types() does
+                int k = nextDateTimeFormat(thisFmt+1, absType==CT_TIME_FMT);
+                if (k>=0) { thisFmt = (int8_t)k; tch = fieldStart; continue; }
+              }
+              if (absType>=CT_STRING) absType = NUMTYPE;  // a string or factor field that Field() could not finish; see thisType<=-NUMTYPE below
+              else while (++absType<CT_STRING && disabled_parsers[absType]) {};
+              // the column's layout (if any) is a date layout when bumped from CT_DATE_FMT to CT_TIME_FMT, so start from the first
+              // time layout; likewise the first date layout when bumped to CT_DATE_FMT from a lower type
+              if (absType==CT_DATE_FMT || absType==CT_TIME_FMT) thisFmt = (int8_t)nextDateTimeFormat(0, absType==CT_TIME_FMT);
+              thisType = -absType;
+              tch = fieldStart;
             }
-            #pragma omp critical
-            {
-              joldType = type[j];  // fetch shared value again in case another thread bumped it while I was waiting.
-              // Can't print because we're likely not master. So accumulate message and print afterwards.
-              if (thisType < joldType) {   // thisType<0 (type-exception)
-                if (verbose) {
-                  char temp[1001];
-                  int len = snprintf(temp, 1000,
-                    _("Column %d%s%.*s%s bumped from '%s' to '%s' due to <<%.*s>> on row %"PRIu64"\n"),
-                    j+1, colNames?" <<":"", colNames?(colNames[j].len):0, colNames?(colNamesAnchor+colNames[j].off):"", colNames?">>":"",
-                    typeName[abs(joldType)], typeName[abs(thisType)],
-                    (int)(tch-fieldStart), fieldStart, (uint64_t)(ctx.DTi+myNrow));
-                  if (len > 1000) len = 1000;
-                  if (len > 0) {
-                    typeBumpMsg = (char*) realloc(typeBumpMsg, typeBumpMsgSize + (size_t)len + 1);
-                    strcpy(typeBumpMsg+typeBumpMsgSize, temp);
-                    typeBumpMsgSize += (size_t)len;
+
+            if (thisType != joldType) {             // rare out-of-sample type exception.
+              if (!checkedNumberOfFields && !fill) {  // fill is always true for fixedWidth
+                // check this line has the correct number of fields. If not, don't apply the bump from this invalid line. Instead fall through to myStopEarly below.
+                const char *tt = fieldStart;
+                int fieldsRemaining = countfields(&tt);
+                if (j+fieldsRemaining != ncol) break;
+                checkedNumberOfFields = true;
+              }
+              if (thisType <= -NUMTYPE) {
+                break;  // Improperly quoted char field needs to be healed below, other columns will be filled #5041 and #4774
+              }
+              #pragma omp critical
+              {
+                joldType = type[j];  // fetch shared value again in case another thread bumped it while I was waiting.
+                // Can't print because we're likely not master, nor is this chunk's first row in DT known yet. So keep the
+                // bump with the chunk and the master writes the message once it knows the row.
+                if (thisType < joldType) {   // thisType<0 (type-exception)
+                  if (verbose) {
+                    if (slot->nBump == slot->bumpCap) {
+                      slot->bumpCap = slot->bumpCap ? 2*slot->bumpCap : 4;
+                      slot->bumps = realloc(slot->bumps, (size_t)slot->bumpCap * sizeof(TypeBump));
+                    }
+                    if (slot->bumps) slot->bumps[slot->nBump++] = (TypeBump){ j, joldType, thisType, (int)(tch-fieldStart), fieldStart, myNrow };
+                    else slot->nBump = slot->bumpCap = 0;  // # nocov; just the verbose message is lost
                   }
-                }
-                nTypeBump++;
-                if (joldType>0) nTypeBumpCols++;
-                type[j] = thisType;
-              } // else another thread just bumped to a (negative) higher or equal type while I was waiting, so do nothing
+                  nTypeBump++;
+                  if (joldType>0) nTypeBumpCols++;
+                  if (bumpJump<0) {
+                    // the master only moves these on between waves, and this wave's first jump started at headPos
+                    bumpJump = wave0;
+                    bumpPos = headPos;
+                    bumpDTi = DTi;
+                  }
+                  if (thisType==-CT_DATE_FMT || thisType==-CT_TIME_FMT) colDateTimeFormat[j] = thisFmt;  // before type as it's read without the critical
+                  type[j] = thisType;
+                  if (schemaTypes && -thisType>schemaTypes[j]) schemaTypes[j] = -thisType;
+                } // else another thread just bumped to a (negative) higher or equal type while I was waiting, so do nothing
+              }
             }
+            int8_t thisSize = size[j];
+            if (thisSize) ((char**) targets)[size[j]] += size[j];  // 'if' to avoid undefined NULL+=0 when rereading
+            j++;
+            if (fixedWidth) {
+              if (j<ncol) continue;
+              tch = lineEnd;
+              break;
+            }
+            if (*tch==sep) { tch++; continue; }
+            if (fill && (*tch=='\n' || *tch=='\r' || tch==eof) && j<ncol) continue;  // reuse processors to write appropriate NA to target; saves maintenance of a type switch down here
+            break;
           }
-          int8_t thisSize = size[j];
-          if (thisSize) ((char**) targets)[size[j]] += size[j];  // 'if' to avoid undefined NULL+=0 when rereading
-          j++;
-          if (*tch==sep) { tch++; continue; }
-          if (fill && (*tch=='\n' || *tch=='\r' || tch==eof) && j<ncol) continue;  // reuse processors to write appropriate NA to target; saves maintenance of a type switch down here
-          break;
-        }
-        if (j<ncol || (!eol(&tch) && tch!=eof))  {
-          // Too few or too many columns observed (but not empty lines when skipEmptyLines as they were found and skipped earlier above).
-          // If fill==true, fields should already have been filled above due to continue inside while(j<ncol).
-          myStopEarly = true;
-          tch = tLineStart;
-          break;
+          if (j<ncol || (!eol(&tch) && tch!=eof))  {
+            // Too few or too many columns observed (but not empty lines when skipEmptyLines as they were found and skipped earlier above).
+            // If fill==true, fields should already have been filled above due to continue inside while(j<ncol).
+            myStopEarly = true;
+            tch = tLineStart;
+            break;
+          }
+          if (tch!=eof) tch++;
+          myNrow++;
         }
-        if (tch!=eof) tch++;
-        myNrow++;
+        if (verbose) { double now = wallclock(); thRead += now-tLast; tLast = now; }
+        ctx.anchor = thisJumpStart;
+        ctx.nRows = myNrow;
+        postprocessBuffer(&ctx);
+
+        // if (tch>nextJumpStart) the next jump is dirty and should be swept. But earlier jumps in this wave may be dirty too, so
+        // sweeping is decided by the master when it walks the wave in order and is at headPos reliably.
+        slot->ctx = ctx;
+        slot->buffRows = myBuffRows;
+        slot->start = thisJumpStart;
+        slot->end = tch;
+        slot->next = nextJumpStart;
+        slot->stopEarly = myStopEarly;
       }
-      if (verbose) { double now = wallclock(); thRead += now-tLast; tLast = now; }
-      ctx.anchor = thisJumpStart;
-      ctx.nRows = myNrow;
-      postprocessBuffer(&ctx);
 
-      // if (tch>nextJumpStart) I know now that the next jump is dirty and should be swept. But, there might be earlier jumps
-      // already waiting at ordered that are dirty too; i.e. it's likely that thisJumpStart!=headPos. Therefore, sweeping must
-      // be triggered not here before ordered but when we're inside ordered and we're at headPos reliably.
-
-      #pragma omp ordered
+      // Phase 2: walk the wave in jump order to assign each chunk its rows in DT. This is just a prefix sum of the row counts
+      // plus the checks that used to be done in an ordered section, so it's quick compared to parsing or pushing.
+      #pragma omp master
       {
-        if (stopTeam) {             // A previous thread stopped while I was waiting my turn to enter ordered
-          myNrow = 0;               // # nocov; discard my buffer
-        }
-        else if (headPos!=thisJumpStart) {
-           // # nocov start
-          snprintf(internalErr, internalErrSize, _("Internal error: invalid head position. jump=%d, headPos=%p, thisJumpStart=%p, sof=%p"), jump, (void*)headPos, (void*)thisJumpStart, (void*)sof);
-          stopTeam = true;
-          // # nocov end
-        }
-        else {
-          ctx.DTi = DTi;  // fetch shared DTi (where to write my results to the answer). The previous thread just told me.
-          if (ctx.DTi + myNrow > allocnrow) {
-            // Guess for DT's nrow was insufficient. We cannot realloc DT now because other threads are pushing to DT now in
-            // parallel. So, stop team, realloc and then restart reading from this jump.
-            extraAllocRows = (int64_t)((double)(DTi+myNrow)*nJumps/(jump+1) * 1.2) - allocnrow;
+        int next = waveEnd;  // the jump the next wave starts from
+        int keep = waveEnd;  // the jumps [keep, waveEnd) are kept for the next wave
+        nPush = 0;
+        push0 = wave0;
+        for (int jump = wave0; jump < waveEnd && !stopTeam; jump++) {
+          const ChunkSlot *slot = &slots[jump%nSlots];
+          ThreadLocalFreadParsingContext *ctx = &slots[jump%nSlots].ctx;
+          const char *thisJumpStart = slot->start, *tch = slot->end, *nextJumpStart = slot->next;
+          if (headPos!=thisJumpStart) {
+            // # nocov start
+            snprintf(internalErr, internalErrSize, _("Internal error: invalid head position. jump=%d, headPos=%p, thisJumpStart=%p, sof=%p"), jump, (void*)headPos, (void*)thisJumpStart, (void*)sof);
+            stopTeam = true;
+            // # nocov end
+          }
+          else if (DTi + (int64_t)ctx->nRows > allocnrow) {
+            // Guess for DT's nrow was insufficient. We cannot realloc DT now because the accepted slots of this wave are about to
+            // be pushed to DT. So, stop team, realloc and then restart reading from this jump.
+            extraAllocRows = (int64_t)((double)(DTi+ctx->nRows)*(jumpEnd-windowJump0)/(jump+1-windowJump0) * 1.2) - allocnrow;
             if (extraAllocRows < 1024) extraAllocRows = 1024;
-            myNrow = 0;    // discard my buffer even though it was read correctly; this one jump will be reread wastefully in this rare case
+            // discard this slot even though it was read correctly; this one jump will be reread wastefully in this rare case
             stopTeam = restartTeam = true;
             jump0 = jump;
           } else {
-            // tell next thread 2 things :
-            headPos = tch;  // i) advance headPos; the jump start up to which all rows have been pushed
-            DTi += myNrow;  // ii) which row in the final result next thread should start writing to since now I know myNrow.
-            ctx.nRows = myNrow;
-            orderBuffer(&ctx);
-            if (myStopEarly) {
+            if (buildRowIndex && firstTime && (rowIndexN==0 || rowsBefore+DTi>rowIndexRow[rowIndexN-1])) {
+              // record where this chunk's rows start, once; a window reread when streaming records the same again
+              if (rowIndexN==rowIndexCap) {
+                rowIndexCap = rowIndexCap ? 2*rowIndexCap : 1024;
+                int64_t *r = realloc(rowIndexRow, (size_t)rowIndexCap*sizeof(int64_t)), *o = realloc(rowIndexOffset, (size_t)rowIndexCap*sizeof(int64_t));
+                if (r) rowIndexRow = r;
+                if (o) rowIndexOffset = o;
+                if (!r || !o) { snprintf(internalErr, internalErrSize, _("Failed to grow the row index to %"PRId64" entries"), rowIndexCap); stopTeam = true; }  // # nocov
+              }
+              if (!stopTeam) {
+                rowIndexRow[rowIndexN] = rowsBefore+DTi;
+                rowIndexOffset[rowIndexN++] = thisJumpStart-sof;
+              }
+            }
+            ctx->DTi = DTi;  // where to write this chunk's rows to in DT
+            headPos = tch;   // the jump start up to which all rows have been accepted
+            DTi += ctx->nRows;
+            nPush++;
+            nKept += slot->kept;
+            orderBuffer(ctx);
+            if (slot->stopEarly) {
               if (quoteRule<3) {
                 quoteRule++;
                 if (quoteRuleBumpedCh == NULL) {
                   // for warning message if the quote rule bump does in fact manage to heal it, e.g. test 1881
-                  quoteRuleBumpedCh = tLineStart;
-                  quoteRuleBumpedLine = row1line+DTi;
+                  quoteRuleBumpedCh = tch;
+                  quoteRuleBumpedLine = row1line+rowsBefore+DTi;
                 }
                 restartTeam = true;
                 jump0 = jump;  // this jump will restart from headPos, not from its beginning, e.g. test 1453
               }
               stopTeam = true;
             } else if (headPos>nextJumpStart) {
-              nSwept++;         // next jump landed awkwardly and will be reread from headPos; i.e. next jump is dirty and will be swept
-              stopTeam = restartTeam = true;
-              jump0 = jump+1;   // restart team from next jump. jump0 always starts from headPos
-              // if too many jumps are dirty, scale down to single-threaded to save restarting team too much, wastefully. The file requires
+              nSwept++;         // next jump landed awkwardly and will be read from headPos in the next wave; i.e. next jump is dirty and will be swept
+              next = jump+1;
+              // The jumps after the dirty one were read from their own starts, which are still right if the reread of the dirty jump
+              // ends where it ended this time; Phase 2 of the next wave checks that as usual. So keep them rather than read them again.
+              keep = jump+2;
+              // if too many jumps are dirty, scale down to single-threaded to save discarding waves too much, wastefully. The file requires
               // a single threaded read anyway due to its tortuous complexity with so many embedded newlines so often
-              if (nth>1 && nSwept>5 && (double)nSwept/jump > 0.10) nth=1;
+              if (nth>1 && nSwept>5 && (double)nSwept/jump > 0.10) {
+                nth = 1;
+                stopTeam = restartTeam = true;
+                jump0 = jump+1;  // restart team from next jump. jump0 always starts from headPos
+              }
+              break;
             }
           }
         }
+        if (stopTeam) keep = waveEnd;  // the slots are freed and reallocated for the restart
+        for (int jump = wave0; jump < waveEnd; jump++) {
+          ChunkSlot *slot = &slots[jump%nSlots];
+          slot->kept = jump>=keep;
+          if (slot->kept) continue;  // its bumps are reported when it is accepted, with its row in DT
+          for (int b=0; b<slot->nBump; b++) {
+            // a chunk that was not accepted is reread from about DTi in the next wave, where its bumps are not found again
+            const TypeBump *tb = &slot->bumps[b];
+            const int j = tb->j;
+            char temp[1001];
+            int len = snprintf(temp, 1000,
+              _("Column %d%s%.*s%s bumped from '%s' to '%s' due to <<%.*s>> on row %"PRIu64"\n"),
+              j+1, colNames?" <<":"", colNames?(colNames[j].len):0, colNames?(colNamesAnchor+colNames[j].off):"", colNames?">>":"",
+              typeName[abs(tb->from)], typeName[abs(tb->to)],
+              tb->len, tb->field, (uint64_t)(rowsBefore + (jump-wave0<nPush ? (int64_t)slot->ctx.DTi : DTi) + tb->row));
+            if (len > 1000) len = 1000;
+            if (len > 0) {
+              typeBumpMsg = (char*) realloc(typeBumpMsg, typeBumpMsgSize + (size_t)len + 1);
+              strcpy(typeBumpMsg+typeBumpMsgSize, temp);
+              typeBumpMsgSize += (size_t)len;
+            }
+          }
+          slot->nBump = 0;
+        }
+        if (myShowProgress && /*wait for all threads to process 2 jumps*/next>=nth*2) {
+          // Important for thread safety inside progess() that this is called from the master thread
+          double now = wallclock();
+          int ETA = (int)(((now-tAlloc)/next) * (nJumps-next));
+          progress((int)(100.0*next/nJumps), ETA);
+        }
+        wave0 = next;
+        waveEnd = imin(next+nSlots, jumpEnd);
+        readDone = stopTeam || wave0>=jumpEnd || (nth==1 && DTi>=nrowLimit);
       }
-      // END ORDERED.
-      // Next thread can now start her ordered section and write her results to the final DT at the same time as me.
-      // Ordered has to be last in some OpenMP implementations currently. Logically though, pushBuffer happens now.
-    }
-    // End for loop over all jump points
-
-    // Push out all buffers one last time (only needed because of gomp ordered workaround above with push first in the loop)
-    // If stopped early, this will happen once for thread at headPos (the only one left with myNrow>0)
-    if (myNrow) {
-      double now = verbose ? wallclock() : 0;
-      pushBuffer(&ctx);
-      if (verbose) thPush += wallclock() - now;
+      #pragma omp barrier
+
+      // Phase 3: all threads transpose the accepted slots to DT at the same time; they write to disjoint rows.
+      // Push buffer now to impl so that :
+      //   i) lenoff.off can be "just" 32bit int from a local anchor rather than a 64bit offset from a global anchor
+      //  ii) impl can do it in parallel if it wishes, and it can have an orphan critical directive if it wishes
+      // iii) so that the slots can be reused by the next wave and be small
+      #pragma omp for schedule(dynamic) reduction(+:thPush)
+      for (int i = 0; i < nPush; i++) {
+        double tLast = verbose ? wallclock() : 0;
+        pushBuffer(&slots[(push0+i)%nSlots].ctx);
+        if (verbose) thPush += wallclock()-tLast;
+      }
+      // implicit barrier at the end of omp for: readDone, wave0 and waveEnd from the master are seen by all threads now
     }
-    // Each thread to free their own buffer.
-    free(ctx.buff8); ctx.buff8 = NULL;
-    free(ctx.buff4); ctx.buff4 = NULL;
-    free(ctx.buff1); ctx.buff1 = NULL;
-    freeThreadContext(&ctx);
   }
   //-- end parallel ------------------
+  for (int i=0; i<nSlots; i++) {
+    ThreadLocalFreadParsingContext *ctx = &slots[i].ctx;
+    free(ctx->buff8); ctx->buff8 = NULL;
+    free(ctx->buff4); ctx->buff4 = NULL;
+    free(ctx->buff1); ctx->buff1 = NULL;
+    freeThreadContext(ctx);
+    free(slots[i].bumps);
+  }
+  free(slots);
 
   if (stopTeam) {
     if (internalErr[0]!='\0') {
@@ -2507,6 +3830,52 @@ int freadMain(freadMainArgs _args) {
       goto read;
     }
     // else nrowLimit applied and stopped early normally
+    stoppedEarly = true;
+  }
+  if (readEnd<eof && !stoppedEarly && DTi<nrowLimit) {
+    // the lines found for nrows= held fewer rows, or the row index ends its range at a recorded row before the end; read
+    // on from there single-threaded, stopping at nrowLimit
+    if (verbose) DTPRINT(_("  %"PRIu64" of %"PRIu64" rows read in parallel; reading the rest single-threaded\n"), (uint64_t)DTi, (uint64_t)nrowLimit);
+    readEnd = eof;
+    nth = 1;
+    jump0 = nJumps-1;
+    goto read;
+  }
+
+  if (args.batchRows>0) {
+    if (nTypeBump) {
+      // Streaming: previous windows have been handed over already, so reread just this window with all columns at their bumped types
+      if (verbose) DTPRINT(_("  %d out-of-sample type bumps in window of jumps [%d..%d): %s. Rereading the window\n"), nTypeBump, windowJump0, jumpEnd, typesAsString(ncol));
+      rowSize1 = rowSize4 = rowSize8 = 0;
+      nStringCols = 0;
+      nNonStringCols = 0;
+      for (int j=0; j<ncol; j++) {
+        if (type[j] == CT_DROP) continue;
+        if (type[j]<0) type[j] = -type[j];
+        size[j] = typeSize[type[j]];
+        rowSize1 += (size[j] & 1);
+        rowSize4 += (size[j] & 4);
+        rowSize8 += (size[j] & 8);
+        if (type[j] >= CT_STRING) nStringCols++; else nNonStringCols++;
+      }
+      allocateDT(type, size, ncol, ndrop, allocnrow);
+      nTypeBump = 0;
+      bumpJump = -1;
+      DTi = 0;
+      headPos = windowPos;
+      jump0 = windowJump0;
+      stoppedEarly = false;
+      goto read;
+    }
+    userStopped = !consumeBatch(DTi);
+    if (!userStopped && !stoppedEarly && jumpEnd<nJumps) {
+      rowsBefore += DTi;
+      DTi = 0;
+      windowPos = headPos;
+      windowJump0 = jump0 = jumpEnd;
+      jumpEnd = (int)imin(jumpEnd+batchJumps, nJumps);
+      goto read;
+    }
   }
 
   // tell progress meter to finish up; e.g. write final newline
@@ -2523,6 +3892,9 @@ int freadMain(freadMainArgs _args) {
 
     if (nTypeBump) {
       if (verbose) DTPRINT(_("  %d out-of-sample type bumps: %s\n"), nTypeBump, typesAsString(ncol));
+      // If every bumped column can be widened, the rows before the wave of the first bump are converted rather than reread
+      bool widen = bumpJump>=0;
+      for (int j=0; j<ncol && widen; j++) if (type[j]<0) widen = widenable(tmpType[j], -type[j]);
       rowSize1 = rowSize4 = rowSize8 = 0;
       nStringCols = 0;
       nNonStringCols = 0;
@@ -2536,7 +3908,7 @@ int freadMain(freadMainArgs _args) {
           rowSize1 += (size[j] & 1);
           rowSize4 += (size[j] & 4);
           rowSize8 += (size[j] & 8);
-          if (type[j] == CT_STRING) nStringCols++; else nNonStringCols++;
+          if (type[j] >= CT_STRING) nStringCols++; else nNonStringCols++;
         } else if (type[j]>=1) {
           // we'll skip over non-bumped columns in the rerun, whilst still incrementing resi (hence not CT_DROP)
           // not -type[i] either because that would reprocess the contents of not-bumped columns wastefully
@@ -2544,13 +3916,22 @@ int freadMain(freadMainArgs _args) {
           size[j] = 0;
         }
       }
+      if (widen) widenRows(tmpType, (size_t)bumpDTi);
       allocateDT(type, size, ncol, ncol - nStringCols - nNonStringCols, DTi);
-      // reread from the beginning
-      DTi = 0;
-      headPos = pos;
-      jump0 = 0;
+      if (widen) {
+        if (verbose) DTPRINT(_("  Converted the %"PRIu64" rows before the first bump to the bumped types. Rereading from there (jump %d)\n"),
+                             (uint64_t)bumpDTi, bumpJump);
+        DTi = bumpDTi;
+        headPos = bumpPos;
+        jump0 = bumpJump;
+      } else {
+        // reread from the beginning
+        DTi = 0;
+        headPos = pos;
+        jump0 = 0;
+      }
       firstTime = false;
-      nSwept = 0;
+      nSwept = nKept = 0;
       goto read;
     }
   } else {
@@ -2559,7 +3940,7 @@ int freadMain(freadMainArgs _args) {
 
   double tTot = tReread-t0;  // tReread==tRead when there was no reread
   if (verbose) DTPRINT(_("Read %"PRIu64" rows x %d columns from %s file in %02d:%06.3f wall clock time\n"),
-       (uint64_t)DTi, ncol-ndrop, filesize_to_str(fileSize), (int)tTot/60, fmod(tTot,60.0));
+       (uint64_t)(rowsBefore+DTi), ncol-ndrop, filesize_to_str(fileSize), (int)tTot/60, fmod(tTot,60.0));
 
   //*********************************************************************************************
   // [12] Finalize the datatable
@@ -2573,7 +3954,7 @@ int freadMain(freadMainArgs _args) {
   }
   setFinalNrow(DTi);
 
-  if (headPos<eof && DTi<nrowLimit) {
+  if (headPos<eof && DTi<nrowLimit && !userStopped) {
     ch = headPos;
     while (ch<eof && isspace(*ch)) ch++;
     if (ch==eof) {
@@ -2590,7 +3971,7 @@ int freadMain(freadMainArgs _args) {
         ch = headPos;
         int tt = countfields(&ch);
         DTWARN(_("Stopped early on line %"PRIu64". Expected %d fields but found %d. Consider fill=TRUE and comment.char=. First discarded non-empty line: <<%s>>"),
-          (uint64_t)DTi+row1line, ncol, tt, strlim(skippedFooter,500));
+          (uint64_t)(rowsBefore+DTi+row1line), ncol, tt, strlim(skippedFooter,500));
       }
     }
   }
@@ -2612,7 +3993,8 @@ int freadMain(freadMainArgs _args) {
     thRead/=nth; thPush/=nth;
     double thWaiting = tReread-tAlloc-thRead-thPush;
     DTPRINT(_("%8.3fs (%3.0f%%) Reading %d chunks (%d swept) of %.3fMB (each chunk %d rows) using %d threads\n"),
-            tReread-tAlloc, 100.0*(tReread-tAlloc)/tTot, nJumps, nSwept, (double)chunkBytes/(1024*1024), (int)(DTi/nJumps), nth);
+            tReread-tAlloc, 100.0*(tReread-tAlloc)/tTot, nJumps, nSwept, (double)chunkBytes/(1024*1024), (int)((rowsBefore+DTi)/nJumps), nth);
+    if (nKept) DTPRINT(_("   %d chunks read after a swept one were kept rather than read again\n"), nKept);
     DTPRINT(_("   + %8.3fs (%3.0f%%) Parse to row-major thread buffers (grown %d times)\n"), thRead, 100.0*thRead/tTot, buffGrown);
     DTPRINT(_("   + %8.3fs (%3.0f%%) Transpose\n"), thPush, 100.0*thPush/tTot);
     DTPRINT(_("   + %8.3fs (%3.0f%%) Waiting\n"), thWaiting, 100.0*thWaiting/tTot);
@@ -2627,6 +4009,25 @@ int freadMain(freadMainArgs _args) {
       free(typeBumpMsg);  // local scope and only populated in verbose mode
     }
   }
+  if (sampleTypes && schemaSavable && ncol>1 && meanLineLen>0 && !autoFirstColName) {
+    // Store the layout as detected from the sample. Not the out-of-sample bumps, nor when a cached schema was used: then the
+    // types stored depend only on the input and arguments which made the key, not on which inputs were read before it.
+    freadSchema thisSchema = {ncol, sampleTypes, sep, quoteRule, args.header, autoSkip, meanLineLen, sdLineLen, minLineLen};
+    putSchema(schemaKey, &thisSchema);
+  }
+  if (buildRowIndex && rowIndexN && !userStopped && !autoFirstColName) {
+    freadRowIndex thisIndex = {ncol, schemaTypes, decimalScale, colDateTimeFormat, sep, quoteRule, args.header, colNamesAnchor-sof,
+                               rowIndexN, rowIndexRow, rowIndexOffset, rowsBefore+DTi};
+    putRowIndex(&thisIndex);
+  }
+  if (args.tail && args.rowIndex && !userStopped && !autoFirstColName) {
+    // The index of the rest of the input, for the next read of the rows appended after these: it starts where this read
+    // stopped, which is the end when it read every row. The types include any bumps so those rows are read the same way.
+    int64_t row0 = 0, offset0 = headPos<eof ? headPos-sof : tailEnd;
+    freadRowIndex thisIndex = {ncol, schemaTypes, decimalScale, colDateTimeFormat, sep, quoteRule, args.header, colNamesAnchor-sof,
+                               1, &row0, &offset0, 0};
+    putRowIndex(&thisIndex);
+  }
   freadCleanup();
   return 1;
 }
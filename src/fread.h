@@ -26,17 +26,24 @@ typedef enum {
   CT_BOOL8_L,
   CT_INT32,        // int32_t
   CT_INT64,        // int64_t
+  CT_DECIMAL,      // int64_t, the value times 10^decimalScale[j] exactly. Never detected, user override only
   CT_FLOAT64,      // double (64-bit IEEE 754 float)
   CT_FLOAT64_EXT,  // double, with NAN/INF literals
   CT_FLOAT64_HEX,  // double, in hexadecimal format
   CT_ISO8601_DATE, // integer, as read from a date in ISO-8601 format
   CT_ISO8601_TIME, // double, as read from a timestamp in ISO-8601 time
+  CT_DATE_FMT,     // integer, as read from a date in the layout args.dateTimeFormats[colDateTimeFormat[j]]
+  CT_TIME_FMT,     // double, as read from a timestamp (or epoch) in the layout args.dateTimeFormats[colDateTimeFormat[j]]
   CT_STRING,       // lenOff struct below
+  CT_FACTOR,       // lenOff like CT_STRING in the thread buffers, int32_t codes into levels at the push. Never detected, user override only
   NUMTYPE          // placeholder for the number of types including drop; used for allocation and loop bounds
 } colType;
 
 extern int8_t typeSize[NUMTYPE];
 extern const char typeName[NUMTYPE][10];
+extern int8_t *decimalScale;
+extern int8_t *colDateTimeFormat;
+bool dateTimeFormatIsTime(const char *format);
 extern const long double pow10lookup[601];
 extern const uint8_t hexdigits[256];
 
@@ -71,6 +78,16 @@ typedef struct freadMainArgs
   // with `filename`.
   const char *input;
 
+  // When non-zero, `input` is instead a buffer of this many bytes which need
+  // not be \0-terminated; e.g. an R raw vector holding a downloaded file. It
+  // may be gzip compressed. fread() does not modify it.
+  size_t inputSize;
+
+  // When >= 0 and neither `filename` nor `input` is given, the input is read
+  // to its end from this file descriptor; e.g. the read end of a pipe from a
+  // command. It need not be seekable. The caller opens and closes it.
+  int inputFd;
+
   // Maximum number of rows to read, or INT64_MAX to read the entire dataset.
   // Note that even if `nrowLimit = 0`, fread() will scan a sample of rows in
   // the file to detect column names and types (and other parsing settings).
@@ -79,6 +96,12 @@ typedef struct freadMainArgs
   // Number of input lines to skip when reading the file.
   int64_t skipNrow;
 
+  // Streaming mode when > 0: the file is read in windows of approximately this
+  // many rows (a whole number of chunks), and each window is passed to
+  // `consumeBatch()` as soon as it has been read. The same DataTable is reused
+  // for every window, so memory stays bounded by the window size.
+  int64_t batchRows;
+
   // Skip to the line containing this string. This parameter cannot be used
   // with `skipLines`.
   const char *skipString;
@@ -88,6 +111,14 @@ typedef struct freadMainArgs
   // the array ends.
   const char * const* NAstrings;
 
+  // NULL-terminated list of date and datetime layouts, such as "%m/%d/%Y" or
+  // "%d-%b-%Y %H:%M:%OS", tried in order on columns which are not ISO-8601.
+  // Only those with `dateTimeDetect[i]` true are tried when detecting types;
+  // the others (e.g. "epoch_ms") are assigned to columns by `userOverride()`
+  // via `colDateTimeFormat`.
+  const char * const* dateTimeFormats;
+  const bool *dateTimeDetect;
+
   // Maximum number of threads. If 0, then fread will use the maximum possible
   // number of threads, as determined by omp_get_max_threads(). If negative,
   // then fread will use that many threads less than allowed maximum (but
@@ -149,7 +180,42 @@ typedef struct freadMainArgs
   // should datetime with no Z or UTZ-offset be read as UTC?
   bool noTZasUTC;
 
-  char _padding[1];
+  // If true, ask `getSchema()` for the layout detected in an earlier read of
+  // input with the same first line, size class and arguments, and if it fits
+  // this input skip the detection of sep, quote rule, ncol, header and column
+  // types (steps 6 and 7). The layout detected or confirmed is passed to
+  // `putSchema()` at the end.
+  bool schemaCache;
+
+  // If true, ask `getRowIndex()` for the row index of this input. If there is
+  // one, its layout and types are used instead of detecting them (steps 6 and
+  // 7), and `nrowLimit` rows are read from data row `firstRow` (0-based) by
+  // starting at the nearest recorded row. Otherwise, when the whole input is
+  // read, the start of every chunk is recorded and passed to `putRowIndex()`
+  // at the end.
+  bool rowIndex;
+  int64_t firstRow;
+
+  // When > 0, the most memory in bytes the read should need. The peak is
+  // estimated before the DataTable is allocated; over-allocation of rows and
+  // the number of chunk buffers (threads) are reduced to fit it, and if that's
+  // not enough, fread stops before allocating with the estimate in the message.
+  size_t memoryLimit;
+
+  // Incremental read of a file which is appended to, such as a log. The
+  // input is read up to its last \n, leaving any line being written. At the
+  // end the index of the rest of the file is passed to `putRowIndex()`: one
+  // entry at the byte the read stopped at, with the layout and types. When
+  // `rowIndex` is also true and `getRowIndex()` returns such an index, only
+  // the bytes from that entry on are read.
+  bool tail;
+
+  // Fixed-width input when nwidths > 0: the width in bytes of each column in
+  // turn from the start of every line, with a negative width skipping that
+  // many bytes between columns. There are no separators or quotes; fields are
+  // parsed by the usual per-type parsers after stripping the padding.
+  const int32_t *widths;
+  int32_t nwidths;
 
   // Any additional implementation-specific parameters.
   FREAD_MAIN_ARGS_EXTRA_FIELDS
@@ -158,6 +224,69 @@ typedef struct freadMainArgs
 
 
 
+// *****************************************************************************
+
+typedef struct freadSchema
+{
+  // Number of columns, and the length of `types`.
+  int ncol;
+
+  // Column types as detected (before user overrides), including any
+  // out-of-sample type bumps when passed to `putSchema()`.
+  int8_t *types;
+
+  char sep;
+  int8_t quoteRule;
+  bool header;
+
+  // Number of lines skipped automatically to reach the column names or first
+  // row, such as a banner before the table.
+  int topSkip;
+
+  // Line length statistics from the sample, used to estimate the number of
+  // rows and so the allocation without sampling again.
+  double meanLineLen;
+  double sdLineLen;
+  int minLineLen;
+
+} freadSchema;
+
+
+
+// *****************************************************************************
+
+typedef struct freadRowIndex
+{
+  // Number of columns, and the length of `types`, `scale` and `fmt`.
+  int ncol;
+
+  // Column types as detected (like freadSchema.types), with the decimalScale
+  // and colDateTimeFormat of each column at the end of the read.
+  int8_t *types;
+  int8_t *scale;
+  int8_t *fmt;
+
+  char sep;
+  int8_t quoteRule;
+  bool header;
+
+  // Byte offset of the first row (the column names when `header`) from the
+  // start of the input.
+  int64_t firstRowOffset;
+
+  // Data row `row[i]` (0-based) starts at byte `offset[i]` of the input, for
+  // `n` entries in increasing order; one per chunk read.
+  int64_t n;
+  int64_t *row;
+  int64_t *offset;
+
+  // The number of data rows in the input.
+  int64_t nrow;
+
+} freadRowIndex;
+
+
+
 // *****************************************************************************
 
 typedef struct ThreadLocalFreadParsingContext
@@ -213,6 +342,9 @@ typedef struct ThreadLocalFreadParsingContext
  *
  * It should have been called just "fread", but that name is already defined in
  * the system libraries...
+ *
+ * Returns 1, or 0 without calling any of the callbacks below when nothing at
+ * all could be read from `inputFd`.
  */
 int freadMain(freadMainArgs args);
 
@@ -301,6 +433,17 @@ size_t allocateDT(int8_t *types, int8_t *sizes, int ncols, int ndrop,
                   size_t nrows);
 
 
+/**
+ * Called just before `allocateDT()` when the columns bumped by out-of-sample
+ * type exceptions can hold the rows read so far exactly at their new types;
+ * e.g. int32 to float64. Then only the rows from `nrows` on are reread, so
+ * `allocateDT()` should convert the first `nrows` rows of each column whose
+ * type changes from `oldTypes[j]` rather than leave them to be overwritten.
+ * It applies to that one next call of `allocateDT()` only.
+ */
+void widenRows(const int8_t *oldTypes, size_t nrows);
+
+
 /**
  * Called once at the beginning of each thread before it starts scanning the
  * input file. If the file needs to be rescanned because of out-of-type
@@ -311,16 +454,17 @@ void prepareThreadContext(ThreadLocalFreadParsingContext *ctx);
 
 /**
  * Give upstream the chance to modify the scanned buffers after the thread
- * finished reading its chunk but before it enters the "ordered" section.
+ * finished reading its chunk, before the chunk's rows in the result are known.
  * Variable `ctx.DTi` is not available at this moment.
  */
 void postprocessBuffer(ThreadLocalFreadParsingContext *ctx);
 
 
 /**
- * Callback invoked within the "ordered" section for each thread. Only
- * lightweight processing should be performed here, since this section stalls
- * execution of any other thread!
+ * Callback invoked on the master thread for each chunk in file order, once
+ * `ctx.DTi` has been assigned. Only lightweight processing should be performed
+ * here, since all other threads wait for the whole wave of chunks to be
+ * ordered before pushing them!
  */
 void orderBuffer(ThreadLocalFreadParsingContext *ctx);
 
@@ -335,6 +479,36 @@ void orderBuffer(ThreadLocalFreadParsingContext *ctx);
 void pushBuffer(ThreadLocalFreadParsingContext *ctx);
 
 
+/**
+ * Streaming mode only (`args.batchRows > 0`). Called on the master thread,
+ * outside the parallel region, each time a window of rows has been read into
+ * rows [0, nrows) of the DataTable. The DataTable is reused for the next window
+ * after this returns; column types may be bumped in a later window. Return
+ * `false` to stop reading.
+ */
+bool consumeBatch(size_t nrows);
+
+
+/**
+ * Schema cache (`args.schemaCache`). `getSchema()` returns true and fills in
+ * `schema` if one has been stored for `key`; `schema->types` must stay valid
+ * until freadMain returns. `putSchema()` stores the schema for `key`,
+ * replacing any previous one. The key is a hash of the first line of the
+ * input, its size class and the arguments which affect detection.
+ */
+bool getSchema(uint64_t key, freadSchema *schema);
+void putSchema(uint64_t key, const freadSchema *schema);
+
+
+/**
+ * Row index (`args.rowIndex`). `getRowIndex()` returns true and fills in `ri`
+ * if there is a row index for this input; its arrays must stay valid until
+ * freadMain returns. `putRowIndex()` stores the one recorded while reading.
+ */
+bool getRowIndex(freadRowIndex *ri);
+void putRowIndex(const freadRowIndex *ri);
+
+
 /**
  * Called at the end to specify what the actual number of rows in the datatable
  * was. The function should adjust the datatable, reallocing the buffers if
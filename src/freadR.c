@@ -1,6 +1,14 @@
 #include "fread.h"
 #include "freadR.h"
 #include "data.table.h"
+#include <errno.h>
+#ifdef WIN32
+  #define popen _popen
+  #define pclose _pclose
+  #define POPEN_MODE "rb"
+#else
+  #define POPEN_MODE "r"
+#endif
 
 /*****    TO DO    *****
 Restore test 1339 (balanced embedded quotes, see ?fread already updated).
@@ -24,9 +32,11 @@ Secondary separator for list() columns, such as columns 11 and 12 in BED (no nee
 
 #define NUT  NUMTYPE+2  // +1 for "numeric" alias for "double"; +1 for CLASS fallback using as.class() at R level afterwards
 
-static int  typeSxp[NUT] =     {NILSXP,  LGLSXP,     LGLSXP,     LGLSXP,     LGLSXP,     INTSXP,    REALSXP,     REALSXP,    REALSXP,        REALSXP,        INTSXP,          REALSXP,         STRSXP,      REALSXP,    STRSXP   };
-static char typeRName[NUT][10]={"NULL",  "logical",  "logical",  "logical",  "logical",  "integer", "integer64", "double",   "double",       "double",       "IDate",         "POSIXct",       "character", "numeric",  "CLASS"  };
-static int  typeEnum[NUT] =    {CT_DROP, CT_BOOL8_N, CT_BOOL8_U, CT_BOOL8_T, CT_BOOL8_L, CT_INT32,  CT_INT64,    CT_FLOAT64, CT_FLOAT64_HEX, CT_FLOAT64_EXT, CT_ISO8601_DATE, CT_ISO8601_TIME, CT_STRING,   CT_FLOAT64, CT_STRING};
+// typeRName is "" (matched by no colClasses=) for CT_DATE_FMT and CT_TIME_FMT, which only dateTimeFormats= chooses, so that "IDate"
+// and "POSIXct" name CT_ISO8601_DATE and CT_ISO8601_TIME alone; e.g. blanking those for oldNoDateTime below leaves them unmatched
+static int  typeSxp[NUT] =     {NILSXP,  LGLSXP,     LGLSXP,     LGLSXP,     LGLSXP,     INTSXP,    REALSXP,     REALSXP,    REALSXP,    REALSXP,        REALSXP,        INTSXP,          REALSXP,         INTSXP,      REALSXP,     STRSXP,      INTSXP,    REALSXP,    STRSXP   };
+static char typeRName[NUT][10]={"NULL",  "logical",  "logical",  "logical",  "logical",  "integer", "integer64", "decimal",  "double",   "double",       "double",       "IDate",         "POSIXct",       "",          "",          "character", "factor",  "numeric",  "CLASS"  };
+static int  typeEnum[NUT] =    {CT_DROP, CT_BOOL8_N, CT_BOOL8_U, CT_BOOL8_T, CT_BOOL8_L, CT_INT32,  CT_INT64,    CT_DECIMAL, CT_FLOAT64, CT_FLOAT64_HEX, CT_FLOAT64_EXT, CT_ISO8601_DATE, CT_ISO8601_TIME, CT_DATE_FMT, CT_TIME_FMT, CT_STRING,   CT_FACTOR, CT_FLOAT64, CT_STRING};
 static colType readInt64As=CT_INT64;
 static SEXP selectSxp;
 static SEXP dropSxp;
@@ -45,6 +55,62 @@ static int64_t dtnrows = 0;
 static bool verbose = false;
 static bool warningsAreErrors = false;
 static bool oldNoDateTime = false;
+static bool localTime = false;  // tz="": datetimes without a time zone are local time, which freadMain does not read
+static SEXP batchFun;     // R function passed each batch of rows when streaming (callback= at R level), otherwise R_NilValue
+static SEXP schemaEnv;    // environment of cached schemas (schemaCache= at R level), otherwise R_NilValue
+static SEXP rowIndexEnv;  // environment holding the row index as `index` (rowIndex= at R level), otherwise R_NilValue
+static bool stringsAsFactors = false;  // read string columns as CT_FACTOR; stringsAsFactors=TRUE at R level
+typedef struct {
+  // The levels of a CT_FACTOR column so far, in order of first appearance. It is plain C so that pushBuffer's critical, which runs
+  // on any thread, does not call R's API; finalizeColumns() makes the CHARSXP of the levels on the master thread.
+  char *chars;           // the bytes of the levels one after another
+  size_t nchars, charsCap;
+  size_t *off;           // level k (1-based) is chars[off[k-1]] to chars[off[k]]; nlevels+1 entries
+  int nlevels, offCap;
+  int *table;            // open addressing hash of the 1-based level codes, at most half full
+  int mask;
+  bool failed;           // out of memory in the critical; raised by the master in factorDictLevels()
+} FactorDict;
+static FactorDict *factorDict; // for each column, nlevels==-1 when not CT_FACTOR; freed by the finalizer of RCHK[4]
+static SEXP dateTimeFormatsSxp;  // layouts for CT_DATE_FMT and CT_TIME_FMT; those named are for that column only
+static int nFiles = 0;      // when reading several files into one table, the number of files; otherwise 0
+static int fileIndex = 0;   // the file being read when nFiles
+static size_t dtOffset = 0; // rows of DT filled by the files before fileIndex; pushBuffer() writes after them
+static int8_t *multiType;   // the type each column of DT holds so far, so that a later file is read at that type or higher
+static int8_t *multiScale;  // decimalScale from the first file, kept for CT_DECIMAL columns of the later files
+static SEXP multiOrder;     // selectRank (as order) from the first file
+static SEXP multiNames;     // the column names of the first file; the later files must have the same
+static const int8_t *widenType; // set by widenRows() for the next allocateDT(): the types the first widenNrow rows were read at
+static size_t widenNrow;
+static SEXP fileRows;       // the number of rows read from each file
+static FILE *cmdPipe = NULL;  // the command of cmd= whose output freadMain reads from the pipe; closed however the read ends
+static bool *decimalCol;  // CT_DECIMAL columns to convert for integer64="double"; kept since type[] is -CT_STRING for them during a reread
+static bool tailMode = false; // tail= at R level: before R 4.5.0 the columns keep their spare capacity as truelength for freadAppendR()
+
+static void freeFactorDicts(SEXP p) {
+  FactorDict *d = R_ExternalPtrAddr(p);
+  if (!d) return;
+  const int n = INTEGER(R_ExternalPtrProtected(p))[0];  // not ncol which the next fread resets
+  for (int i=0; i<n; i++) { free(d[i].chars); free(d[i].off); free(d[i].table); }
+  free(d);
+  R_ClearExternalPtr(p);
+}
+
+static void closeCmdPipe(void *unused) {
+  if (cmdPipe) pclose(cmdPipe);  // the command's exit status is not checked, as before when its output went to a file first
+  cmdPipe = NULL;
+}
+
+typedef struct {
+  freadMainArgs *args;
+  bool any;
+} CmdRead;
+
+static SEXP readCmdPipe(void *data) {
+  CmdRead *r = (CmdRead *)data;
+  r->any = freadMain(*r->args);
+  return R_NilValue;
+}
 
 
 SEXP freadR(
@@ -73,7 +139,18 @@ SEXP freadR(
   SEXP integer64Arg,
   SEXP encodingArg,
   SEXP keepLeadingZerosArgs,
-  SEXP noTZasUTC
+  SEXP noTZasUTC,
+  SEXP callbackArg,
+  SEXP batchRowsArg,
+  SEXP schemaCacheArg,
+  SEXP stringsAsFactorsArg,
+  SEXP dateTimeFormatsArg,
+  SEXP rowIndexArg,
+  SEXP firstRowArg,
+  SEXP cmdArg,
+  SEXP memoryLimitArg,
+  SEXP widthsArg,
+  SEXP tailArg
 ) {
   verbose = LOGICAL(verboseArg)[0];
   warningsAreErrors = LOGICAL(warnings2errorsArg)[0];
@@ -81,22 +158,39 @@ SEXP freadR(
   freadMainArgs args;
   ncol = 0;
   dtnrows = 0;
-  const char *ch, *ch2;
-  if (!isString(inputArg) || LENGTH(inputArg)!=1)
-    error(_("Internal error: freadR input not a single character string: a filename or the data itself. Should have been caught at R level."));  // # nocov
-  ch = ch2 = (const char *)CHAR(STRING_ELT(inputArg,0));
-  while (*ch2!='\n' && *ch2!='\r' && *ch2!='\0') ch2++;
-  args.input = (*ch2=='\0') ? R_ExpandFileName(ch) : ch; // for convenience so user doesn't have to call path.expand()
-
-  ch = args.input;
-  while (*ch!='\0' && *ch!='\n' && *ch!='\r') ch++;
-  if (*ch!='\0' || args.input[0]=='\0') {
-    if (verbose) DTPRINT(_("Input contains a \\n or is \")\". Taking this to be text input (not a filename)\n"));
-    args.filename = NULL;
+  const char *ch, *ch2, *cmd = NULL;
+  nFiles = 0;
+  fileIndex = 0;
+  dtOffset = 0;
+  widenType = NULL;
+  args.filename = args.input = NULL;
+  args.inputSize = 0;
+  args.inputFd = -1;
+  if (TYPEOF(inputArg)==RAWSXP) {
+    if (verbose) DTPRINT(_("Input is a raw vector. Reading it from memory\n"));
+    args.input = (const char *)RAW(inputArg);
+    args.inputSize = (size_t)xlength(inputArg);
+  } else if (!isString(inputArg) || LENGTH(inputArg)<1) {
+    error(_("Internal error: freadR input not a character string or raw vector: a filename, the data itself, several filenames or a command. Should have been caught at R level."));  // # nocov
+  } else if (LOGICAL(cmdArg)[0]) {
+    if (verbose) DTPRINT(_("Input is a command. Reading its output from a pipe\n"));
+    cmd = CHAR(STRING_ELT(inputArg,0));  // the pipe is opened just before freadMain below
   } else {
-    if (verbose) DTPRINT(_("Input contains no \\n. Taking this to be a filename to open\n"));
-    args.filename = args.input;
-    args.input = NULL;
+    nFiles = LENGTH(inputArg)>1 ? LENGTH(inputArg) : 0;
+    ch = ch2 = (const char *)CHAR(STRING_ELT(inputArg,0));
+    while (*ch2!='\n' && *ch2!='\r' && *ch2!='\0') ch2++;
+    args.input = (*ch2=='\0') ? R_ExpandFileName(ch) : ch; // for convenience so user doesn't have to call path.expand()
+
+    ch = args.input;
+    while (*ch!='\0' && *ch!='\n' && *ch!='\r') ch++;
+    if (*ch!='\0' || args.input[0]=='\0') {
+      if (verbose) DTPRINT(_("Input contains a \\n or is \")\". Taking this to be text input (not a filename)\n"));
+      args.filename = NULL;
+    } else {
+      if (verbose) DTPRINT(_("Input contains no \\n. Taking this to be a filename to open\n"));
+      args.filename = args.input;
+      args.input = NULL;
+    }
   }
 
   if (!isString(sepArg) || LENGTH(sepArg)!=1 || strlen(CHAR(STRING_ELT(sepArg,0)))>1)
@@ -161,6 +255,50 @@ SEXP freadR(
   args.warningsAreErrors = warningsAreErrors;
   args.keepLeadingZeros = LOGICAL(keepLeadingZerosArgs)[0];
   args.noTZasUTC = LOGICAL(noTZasUTC)[0];
+  localTime = !args.noTZasUTC;
+  batchFun = callbackArg;
+  args.batchRows = 0;
+  if (!isNull(batchFun)) {
+    if (!isFunction(batchFun)) error(_("Internal error: freadR callback is not a function. R level catches this."));  // # nocov
+    if (!isReal(batchRowsArg) || LENGTH(batchRowsArg)!=1 || !R_FINITE(REAL(batchRowsArg)[0]) || REAL(batchRowsArg)[0]<1.0)
+      error(_("Internal error: freadR batchRows not a single number >= 1. R level catches this."));  // # nocov
+    args.batchRows = (int64_t)(REAL(batchRowsArg)[0]);
+  }
+  schemaEnv = schemaCacheArg;
+  if (!isNull(schemaEnv) && !isEnvironment(schemaEnv)) error(_("Internal error: freadR schemaCache is not an environment. R level catches this."));  // # nocov
+  args.schemaCache = !isNull(schemaEnv);
+  rowIndexEnv = rowIndexArg;
+  if (!isNull(rowIndexEnv) && !isEnvironment(rowIndexEnv)) error(_("Internal error: freadR rowIndex is not an environment. R level catches this."));  // # nocov
+  args.rowIndex = !isNull(rowIndexEnv);
+  args.firstRow = (int64_t)REAL(firstRowArg)[0];
+  args.memoryLimit = (size_t)REAL(memoryLimitArg)[0];  // 0 for none
+  args.widths = NULL;
+  args.nwidths = 0;
+  if (!isNull(widthsArg)) {
+    if (!isInteger(widthsArg)) error(_("Internal error: freadR widths is not integer. R level catches this."));  // # nocov
+    args.widths = INTEGER(widthsArg);
+    args.nwidths = LENGTH(widthsArg);
+  }
+  tailMode = args.tail = LOGICAL(tailArg)[0]==TRUE;
+  stringsAsFactors = LOGICAL(stringsAsFactorsArg)[0]==TRUE;
+  dateTimeFormatsSxp = dateTimeFormatsArg;
+  args.dateTimeFormats = NULL;
+  args.dateTimeDetect = NULL;
+  if (length(dateTimeFormatsSxp)) {
+    if (!isString(dateTimeFormatsSxp) || LENGTH(dateTimeFormatsSxp)>INT8_MAX)
+      error(_("Internal error: freadR dateTimeFormats is not a character vector of at most %d layouts. R level catches this."), INT8_MAX);  // # nocov
+    const int n = LENGTH(dateTimeFormatsSxp);
+    SEXP names = getAttrib(dateTimeFormatsSxp, R_NamesSymbol);
+    const char **formats = (const char **)R_alloc(n+1, sizeof(char *));
+    bool *detect = (bool *)R_alloc(n, sizeof(bool));
+    for (int i=0; i<n; i++) {
+      formats[i] = CHAR(STRING_ELT(dateTimeFormatsSxp, i));
+      detect[i] = isNull(names) || STRING_ELT(names, i)==R_BlankString;
+    }
+    formats[n] = NULL;
+    args.dateTimeFormats = formats;
+    args.dateTimeDetect = detect;
+  }
 
   // === extras used for callbacks ===
   if (!isString(integer64Arg) || LENGTH(integer64Arg)!=1) error(_("'integer64' must be a single character string"));
@@ -212,10 +350,45 @@ SEXP freadR(
   else STOP(_("encoding='%s' invalid. Must be 'unknown', 'Latin-1' or 'UTF-8'"), tt);  // # nocov
   // === end extras ===
 
-  RCHK = PROTECT(allocVector(VECSXP, 4));
+  RCHK = PROTECT(allocVector(VECSXP, 9));
   // see kalibera/rchk#9 and Rdatatable/data.table#2865.  To avoid rchk false positives.
   // allocateDT() assigns DT to position 0. userOverride() assigns colNamesSxp to position 1 and colClassesAs to position 2 (both used in allocateDT())
-  freadMain(args);
+  // allocateDT() assigns the external pointer which owns factorDict to position 4 when there are CT_FACTOR columns
+  // When reading several files, positions 6 to 8 hold multiOrder, multiNames and fileRows
+  factorDict = NULL;
+  multiOrder = NULL;
+  if (nFiles) {
+    // Each file is read by freadMain in turn using all threads, into the rows of DT after those of the files before it
+    SET_VECTOR_ELT(RCHK, 8, fileRows=allocVector(REALSXP, nFiles));  // double since one file may have more than INT_MAX rows
+    for (int i=0; i<nFiles; i++) REAL(fileRows)[i] = 0;
+    for (fileIndex=0; fileIndex<nFiles; fileIndex++) {
+      args.filename = R_ExpandFileName(CHAR(STRING_ELT(inputArg, fileIndex)));
+      args.input = NULL;
+      if (verbose) DTPRINT(_("Reading file %d of %d: %s\n"), fileIndex+1, nFiles, args.filename);
+      freadMain(args);
+    }
+    if (length(DT)) setAttrib(DT, install("fileRows"), fileRows);
+  } else {
+    bool any;
+    if (cmd) {
+      cmdPipe = popen(cmd, POPEN_MODE);
+      if (!cmdPipe) error(_("Unable to run the command '%s': %s"), cmd, strerror(errno));  // # nocov
+      args.inputFd = fileno(cmdPipe);
+      // the pipe is closed on every exit: an error() from freadMain or from userOverride() and allocateDT() called back
+      // from it, or an interrupt, as well as when the read finishes
+      CmdRead r = {&args, false};
+      R_ExecWithCleanup(readCmdPipe, &r, closeCmdPipe, NULL);
+      any = r.any;
+    } else {
+      any = freadMain(args);
+    }
+    if (!any) {
+      UNPROTECT(1);
+      return R_NilValue;  // the command output nothing; fread.R warns as it does for an empty file
+    }
+  }
+  if (factorDict) freeFactorDicts(VECTOR_ELT(RCHK, 4));  // now rather than at the next gc; the finalizer covers an error
+  factorDict = NULL;
   UNPROTECT(1);
   return DT;
 }
@@ -247,6 +420,80 @@ static void applyDrop(SEXP items, int8_t *type, int ncol, int dropSource) {
   UNPROTECT(1);
 }
 
+static int8_t typeRepr(int8_t t) {
+  // the type which stands for all types held in a column in the same way; e.g. CT_BOOL8_* are all logical
+  if (t>=CT_BOOL8_N && t<=CT_BOOL8_L) return CT_BOOL8_N;
+  if (t==CT_FLOAT64_EXT || t==CT_FLOAT64_HEX) return CT_FLOAT64;
+  if (t==CT_DATE_FMT) return CT_ISO8601_DATE;
+  if (t==CT_TIME_FMT) return CT_ISO8601_TIME;
+  return t;
+}
+
+static int8_t combineTypes(int8_t prev, int8_t t) {
+  // The type to read a column of a later file at, given that the earlier files are held as prev: t when it is held the same
+  // way, otherwise the lowest type both can be converted to, as rbindlist() does
+  const int8_t rp = typeRepr(prev), rt = typeRepr(t);
+  if (rp==rt) return t;
+  if (rp<=CT_FLOAT64 && rt<=CT_FLOAT64) return prev>t ? prev : t;
+  if ((rp==CT_ISO8601_DATE || rp==CT_ISO8601_TIME) && (rt==CT_ISO8601_DATE || rt==CT_ISO8601_TIME))
+    return (t==CT_DATE_FMT || t==CT_TIME_FMT) ? CT_TIME_FMT : CT_ISO8601_TIME;  // a date is midnight
+  return CT_STRING;
+}
+
+static void convertRows(SEXP from, int8_t fromType, SEXP to, int8_t toType, int scale, SEXP levels, size_t n) {
+  // Convert the first n rows of column from (of the earlier files) into column to, when a later file needs the higher type toType.
+  // levels are those of a CT_FACTOR column from, which has no levels attribute yet
+  const int8_t rf = typeRepr(fromType), rt = typeRepr(toType);
+  if (rt==CT_STRING) {
+    if (rf==CT_FACTOR) {
+      // the codes are still in order of first appearance; finalizeColumns() has not sorted them
+      const int *f = INTEGER(from);
+      for (size_t i=0; i<n; i++) SET_STRING_ELT(to, i, f[i]==NA_INTEGER ? NA_STRING : STRING_ELT(levels, f[i]-1));
+    } else if (rf==CT_INT64 || rf==CT_DECIMAL) {
+      // without relying on bit64's as.character method, and exactly for decimal
+      const int64_t *v = (const int64_t *)REAL(from);
+      const int64_t p = rf==CT_DECIMAL ? (int64_t)(pow(10.0, scale)+0.5) : 1;
+      char buf[32];
+      for (size_t i=0; i<n; i++) {
+        if (v[i]==NA_INT64) { SET_STRING_ELT(to, i, NA_STRING); continue; }
+        const uint64_t a = v[i]<0 ? -(uint64_t)v[i] : (uint64_t)v[i];
+        if (p==1) snprintf(buf, 32, "%s%"PRIu64, v[i]<0?"-":"", a);
+        else      snprintf(buf, 32, "%s%"PRIu64".%0*"PRIu64, v[i]<0?"-":"", a/(uint64_t)p, scale, a%(uint64_t)p);
+        SET_STRING_ELT(to, i, mkChar(buf));
+      }
+    } else {
+      // as.character dispatches on class; e.g. "2020-01-31" for IDate
+      SEXP part = PROTECT(growVector(from, n));
+      copyMostAttrib(from, part);
+      SEXP call = PROTECT(lang2(install("as.character"), part));
+      SEXP s = PROTECT(eval(call, R_BaseEnv));
+      for (size_t i=0; i<n; i++) SET_STRING_ELT(to, i, STRING_ELT(s, i));
+      UNPROTECT(3);
+    }
+    return;
+  }
+  if ((rf==CT_BOOL8_N || rf==CT_INT32) && rt==CT_INT32) {
+    const int *f = INTEGER(from);  // LOGICAL is int and NA_LOGICAL==NA_INTEGER
+    int *d = INTEGER(to);
+    for (size_t i=0; i<n; i++) d[i] = f[i];
+  } else if ((rf==CT_BOOL8_N || rf==CT_INT32) && (rt==CT_INT64 || rt==CT_FLOAT64)) {
+    const int *f = INTEGER(from);
+    if (rt==CT_INT64) { int64_t *d = (int64_t *)REAL(to); for (size_t i=0; i<n; i++) d[i] = f[i]==NA_INTEGER ? NA_INT64 : f[i]; }
+    else              { double  *d = REAL(to);            for (size_t i=0; i<n; i++) d[i] = f[i]==NA_INTEGER ? NA_REAL : f[i]; }
+  } else if ((rf==CT_INT64 || rf==CT_DECIMAL) && rt==CT_FLOAT64) {
+    const int64_t *f = (const int64_t *)REAL(from);
+    const double p = rf==CT_DECIMAL ? pow(10.0, scale) : 1.0;
+    double *d = REAL(to);
+    for (size_t i=0; i<n; i++) d[i] = f[i]==NA_INT64 ? NA_REAL : (double)f[i]/p;
+  } else if (rf==CT_ISO8601_DATE && rt==CT_ISO8601_TIME) {
+    const int *f = INTEGER(from);
+    double *d = REAL(to);
+    for (size_t i=0; i<n; i++) d[i] = f[i]==NA_INTEGER ? NA_REAL : 86400.0*f[i];
+  } else {
+    STOP(_("Internal error: reading several files, cannot convert column type %d to %d"), fromType, toType);  // # nocov
+  }
+}
+
 bool userOverride(int8_t *type, lenOff *colNames, const char *anchor, const int ncol)
 {
   // use typeSize superfluously to avoid not-used warning; otherwise could move typeSize from fread.h into fread.c
@@ -265,6 +512,16 @@ bool userOverride(int8_t *type, lenOff *colNames, const char *anchor, const int
     }
     SET_STRING_ELT(colNamesSxp, i, elem);
   }
+  if (nFiles && fileIndex>0) {
+    const int n = LENGTH(multiNames);
+    for (int i=0; i<ncol || i<n; i++) {
+      if (i<ncol && i<n && STRING_ELT(colNamesSxp, i)==STRING_ELT(multiNames, i)) continue;
+      STOP(_("Column %d of file %d is '%s' but '%s' in the first file. Files read together must have the same columns in the same order; otherwise use rbindlist(lapply(files, fread), use.names=TRUE, fill=TRUE)."),
+           i+1, fileIndex+1, i<ncol ? CHAR(STRING_ELT(colNamesSxp, i)) : "<missing>", i<n ? CHAR(STRING_ELT(multiNames, i)) : "<missing>");
+    }
+  } else if (nFiles) {
+    SET_VECTOR_ELT(RCHK, 7, multiNames=colNamesSxp);
+  }
   // "use either select= or drop= but not both" was checked earlier in freadR
   applyDrop(dropSxp, type, ncol, /*dropSource=*/-1);
   if (TYPEOF(colClassesSxp)==VECSXP) {  // not isNewList() because that returns true for NULL
@@ -310,7 +567,7 @@ bool userOverride(int8_t *type, lenOff *colNames, const char *anchor, const int
   colClassesAs = NULL;
   if (length(colClassesSxp)) {
     SEXP typeRName_sxp = PROTECT(allocVector(STRSXP, NUT));
-    for (int i=0; i<NUT; i++) SET_STRING_ELT(typeRName_sxp, i, mkChar(typeRName[i]));
+    for (int i=0; i<NUT; i++) SET_STRING_ELT(typeRName_sxp, i, typeRName[i][0] ? mkChar(typeRName[i]) : NA_STRING);
     if (oldNoDateTime) {
       // prevent colClasses="IDate"/"POSIXct" being recognized so that colClassesAs is assigned here ready for type massage after reading at R level; test 2150.14
       SET_STRING_ELT(typeRName_sxp, CT_ISO8601_DATE, R_BlankString);
@@ -395,7 +652,7 @@ bool userOverride(int8_t *type, lenOff *colNames, const char *anchor, const int
               if (type[k-1]<0)
                 DTWARN(_("Column %d ('%s') appears more than once in colClasses. The second time is colClasses[[%d]][%d]."), k, CHAR(STRING_ELT(colNamesSxp,k-1)), i+1, j+1);
               else if (type[k-1]!=CT_DROP) {
-                if (thisType==CT_ISO8601_TIME && type[k-1]!=CT_ISO8601_TIME) {
+                if (thisType==CT_ISO8601_TIME && type[k-1]!=CT_ISO8601_TIME && type[k-1]!=CT_TIME_FMT) {
                   type[k-1] = -CT_STRING; // don't use in-built UTC parser, defer to character and as.POSIXct afterwards which reads in local time
                   SET_STRING_ELT(colClassesAs, k-1, STRING_ELT(listNames,i));
                 } else {
@@ -422,16 +679,121 @@ bool userOverride(int8_t *type, lenOff *colNames, const char *anchor, const int
   UNPROTECT(nprotect);
   if (readInt64As != CT_INT64) {
     for (int i=0; i<ncol; i++) if (type[i]==CT_INT64) type[i] = readInt64As;
+    // otherwise decimal columns are read as scaled int64 and converted to double afterwards in finalizeColumns()
+    if (readInt64As==CT_STRING) for (int i=0; i<ncol; i++) if (type[i]==CT_DECIMAL) type[i] = CT_STRING;
+  }
+  if (stringsAsFactors) {
+    // columns left as character for conversion afterwards at R level (colClassesAs) stay character
+    for (int i=0; i<ncol; i++) if (type[i]==CT_STRING && (!colClassesAs || STRING_ELT(colClassesAs,i)==R_BlankString)) type[i] = CT_FACTOR;
+  }
+  SEXP dtfNames = getAttrib(dateTimeFormatsSxp, R_NamesSymbol);
+  if (!isNull(dtfNames)) {
+    // a named layout applies to that column whatever its detected type, so after integer64= and stringsAsFactors= above
+    SEXP cols = PROTECT(chmatch(dtfNames, colNamesSxp, NA_INTEGER));
+    for (int i=0; i<LENGTH(cols); i++) {
+      if (STRING_ELT(dtfNames, i)==R_BlankString) continue;
+      const int k = INTEGER(cols)[i];
+      const char *layout = CHAR(STRING_ELT(dateTimeFormatsSxp, i));
+      if (k==NA_INTEGER) {
+        DTWARN(_("Column name '%s' (dateTimeFormats[%d]) not found"), CHAR(STRING_ELT(dtfNames, i)), i+1);
+      } else if (type[k-1]!=CT_DROP) {
+        const bool isTime = dateTimeFormatIsTime(layout);
+        if (isTime && localTime && strncmp(layout, "epoch", 5)) {
+          // local time for tz="", as unmarked ISO-8601 datetimes are; read as character for as.POSIXct(format=) at R level
+          type[k-1] = CT_STRING;
+        } else {
+          type[k-1] = isTime ? CT_TIME_FMT : CT_DATE_FMT;
+          colDateTimeFormat[k-1] = (int8_t)i;
+        }
+      }
+    }
+    UNPROTECT(1);
+  }
+  if (nFiles && fileIndex>0) {
+    // read at least at the types of the files before, which freadMain accepts as overrides to a higher type
+    for (int i=0; i<ncol; i++) if (type[i]!=CT_DROP) {
+      type[i] = combineTypes(multiType[i], type[i]);
+      if (type[i]==CT_DECIMAL) decimalScale[i] = multiScale[i];
+    }
+    selectRank = multiOrder;  // selectRank was recalculated above but the column order is the first file's
   }
   return true;
 }
 
 
+static inline int factorSlot(const char *str, int len, int mask) {
+  uint32_t h = 2166136261u ^ (uint32_t)len;  // FNV-1a as in dedupStrings()
+  for (int k=0; k<len; k++) h = (h ^ (uint8_t)str[k]) * 16777619u;
+  return (int)(h & (uint32_t)mask);
+}
+
+static int factorCode(int j, const char *str, int len) {
+  // The level code of the len bytes at str in the CT_FACTOR column j (file column number), adding it as a new level if it's the
+  // first time it has been seen. Called inside pushBuffer's critical on any thread, so uses only C: the strings are made into
+  // CHARSXP by the master in finalizeColumns(). The encoding is the same for the whole read, so equal bytes are the same level.
+  FactorDict *d = factorDict+j;
+  if (d->failed) return NA_INTEGER;
+  int slot = factorSlot(str, len, d->mask);
+  for (int c; (c=d->table[slot]); slot=(slot+1)&d->mask) {
+    if (d->off[c]-d->off[c-1]==(size_t)len && memcmp(d->chars+d->off[c-1], str, len)==0) return c;
+  }
+  if (d->nlevels==INT_MAX-1) { d->failed = true; return NA_INTEGER; }  // # nocov
+  if (d->nlevels+1==d->offCap) {
+    size_t *tmp = realloc(d->off, 2*(size_t)d->offCap*sizeof(size_t));
+    if (!tmp) { d->failed = true; return NA_INTEGER; }  // # nocov
+    d->off = tmp;
+    d->offCap *= 2;
+  }
+  if (d->nchars+len > d->charsCap) {
+    size_t cap = 2*d->charsCap > d->nchars+len ? 2*d->charsCap : d->nchars+len;
+    char *tmp = realloc(d->chars, cap);
+    if (!tmp) { d->failed = true; return NA_INTEGER; }  // # nocov
+    d->chars = tmp;
+    d->charsCap = cap;
+  }
+  memcpy(d->chars+d->nchars, str, len);
+  d->nchars += len;
+  const int n = ++d->nlevels;
+  d->off[n] = d->nchars;
+  d->table[slot] = n;
+  if (2*n > d->mask) {
+    // keep the table at most half full
+    const int mask = 2*d->mask+1;
+    int *t = calloc((size_t)mask+1, sizeof(int));
+    if (!t) { d->failed = true; return NA_INTEGER; }  // # nocov
+    for (int c=1; c<=n; c++) {
+      slot = factorSlot(d->chars+d->off[c-1], (int)(d->off[c]-d->off[c-1]), mask);
+      while (t[slot]) slot = (slot+1) & mask;
+      t[slot] = c;
+    }
+    free(d->table);
+    d->table = t;
+    d->mask = mask;
+  }
+  return n;
+}
+
+static SEXP factorDictLevels(int j) {
+  // the levels of CT_FACTOR column j in order of first appearance, as CHARSXP made on the master thread; not protected
+  FactorDict *d = factorDict+j;
+  if (d->failed) STOP(_("Unable to allocate memory for the levels of factor column %d"), j+1);  // # nocov
+  SEXP ans = allocVector(STRSXP, d->nlevels);
+  for (int k=0; k<d->nlevels; k++) SET_STRING_ELT(ans, k, mkCharLenCE(d->chars+d->off[k], (int)(d->off[k+1]-d->off[k]), ienc));
+  return ans;
+}
+
 size_t allocateDT(int8_t *typeArg, int8_t *sizeArg, int ncolArg, int ndrop, size_t allocNrow) {
   // save inputs for use by pushBuffer
   size = sizeArg;
   type = typeArg;
   int newDT = (ncol == 0);
+  if (nFiles) {
+    // DT holds dtOffset rows from the files before and needs room for this file's allocNrow; when it doesn't have it, the
+    // allocation is for the files still to come too, estimated from the rows per file so far
+    const size_t needed = dtOffset + allocNrow;
+    if (newDT || needed>(size_t)dtnrows) allocNrow = needed + needed/(fileIndex+1)*(nFiles-fileIndex-1);
+    else allocNrow = dtnrows;
+  }
   if (newDT) {
     ncol = ncolArg;
     dtnrows = allocNrow;
@@ -467,6 +829,37 @@ size_t allocateDT(int8_t *typeArg, int8_t *sizeArg, int ncolArg, int ndrop, size
     for (int i=0; i<n; ++i) if (STRING_ELT(colClassesAs,i) != R_BlankString) { none=false; break; }
     if (none) setAttrib(DT, sym_colClassesAs, R_NilValue);
     else if (selectRank) setAttrib(DT, sym_colClassesAs, subsetVector(colClassesAs, selectRank));  // reorder the colClassesAs
+    decimalCol = (bool *)R_alloc(ncol, sizeof(bool));
+    if (nFiles) {
+      multiType = (int8_t *)R_alloc(ncol, sizeof(int8_t));
+      multiScale = (int8_t *)R_alloc(ncol, sizeof(int8_t));
+      memcpy(multiScale, decimalScale, ncol);
+      if (selectRank) SET_VECTOR_ELT(RCHK, 6, multiOrder=selectRank);
+    }
+    bool anyFactor = false;
+    for (int i=0; i<ncol; i++) anyFactor |= (type[i]==CT_FACTOR);
+    if (anyFactor) {
+      FactorDict *d = calloc(ncol, sizeof(FactorDict));
+      if (!d) STOP(_("Unable to allocate the level dictionaries of %d columns"), ncol);  // # nocov
+      SEXP p = R_MakeExternalPtr(d, R_NilValue, PROTECT(ScalarInteger(ncol)));
+      SET_VECTOR_ELT(RCHK, 4, p);
+      UNPROTECT(1);
+      R_RegisterCFinalizerEx(p, freeFactorDicts, FALSE);
+      factorDict = d;
+      for (int i=0; i<ncol; i++) {
+        d[i].nlevels = -1;
+        if (type[i]!=CT_FACTOR) continue;
+        d[i].table = calloc(128, sizeof(int));
+        d[i].off = malloc(65*sizeof(size_t));
+        d[i].chars = malloc(1024);
+        if (!d[i].table || !d[i].off || !d[i].chars) STOP(_("Unable to allocate the level dictionaries of %d columns"), ncol);  // # nocov
+        d[i].mask = 127;
+        d[i].offCap = 65;
+        d[i].charsCap = 1024;
+        d[i].off[0] = 0;
+        d[i].nlevels = 0;
+      }
+    }
   }
   // TODO: move DT size calculation into a separate function (since the final size is different from the initial size anyways)
   size_t DTbytes = SIZEOF(DT)*(ncol-ndrop)*2; // the VECSXP and its column names (exclude global character cache usage)
@@ -481,26 +874,43 @@ size_t allocateDT(int8_t *typeArg, int8_t *sizeArg, int ncolArg, int ndrop, size
   //   * otherwise leave the column as-is.
   for (int i=0, resi=0; i<ncol; i++) {
     if (type[i] == CT_DROP) continue;
+    if (type[i] > 0) decimalCol[i] = (type[i]==CT_DECIMAL);  // false once bumped to float64 out-of-sample
     SEXP col = VECTOR_ELT(DT, resi);
     int oldIsInt64 = newDT? 0 : INHERITS(col, char_integer64);
-    int newIsInt64 = type[i] == CT_INT64;
-    int typeChanged = (type[i] > 0) && (newDT || TYPEOF(col) != typeSxp[type[i]] || oldIsInt64 != newIsInt64);
+    int newIsInt64 = type[i]==CT_INT64;  // not CT_DECIMAL which is double once finalized
+    int typeChanged = (type[i] > 0) && (newDT || TYPEOF(col) != typeSxp[type[i]] || oldIsInt64 != newIsInt64 ||
+                                        (nFiles && typeRepr(type[i])!=typeRepr(multiType[i])));  // e.g. int32 to IDate
     int nrowChanged = (allocNrow != dtnrows);
     if (typeChanged || nrowChanged) {
-      SEXP thiscol = typeChanged ? allocVector(typeSxp[type[i]], allocNrow)  // no need to PROTECT, passed immediately to SET_VECTOR_ELT, see R-exts 5.9.1
-                                 : growVector(col, allocNrow);
+      SEXP thiscol = PROTECT(typeChanged ? allocVector(typeSxp[type[i]], allocNrow) : growVector(col, allocNrow));
+      if (typeChanged && widenType && widenType[i]>0) {
+        // the rows read so far are kept; those of earlier files are at this file's types already
+        convertRows(col, widenType[i], thiscol, type[i], 0, R_NilValue, dtOffset+widenNrow);
+      } else if (typeChanged && dtOffset) {
+        const bool wasFactor = multiType[i]==CT_FACTOR;
+        SEXP levels = PROTECT(wasFactor ? factorDictLevels(i) : R_NilValue);
+        convertRows(col, multiType[i], thiscol, type[i], multiScale[i], levels, dtOffset);
+        UNPROTECT(1);
+        if (wasFactor) {
+          // now character, so finalizeColumns() must not recode it
+          FactorDict *d = factorDict+i;
+          free(d->chars); free(d->off); free(d->table);
+          *d = (FactorDict){ .nlevels=-1 };
+        }
+      }
       SET_VECTOR_ELT(DT,resi,thiscol);
-      if (type[i]==CT_INT64) {
+      UNPROTECT(1);
+      if (newIsInt64) {
         SEXP tt = PROTECT(ScalarString(char_integer64));
         setAttrib(thiscol, R_ClassSymbol, tt);
         UNPROTECT(1);
-      } else if (type[i] == CT_ISO8601_DATE) {
+      } else if (type[i] == CT_ISO8601_DATE || type[i] == CT_DATE_FMT) {
         SEXP tt = PROTECT(allocVector(STRSXP, 2));
         SET_STRING_ELT(tt, 0, char_IDate);
         SET_STRING_ELT(tt, 1, char_Date);
         setAttrib(thiscol, R_ClassSymbol, tt);
         UNPROTECT(1);
-      } else if (type[i] == CT_ISO8601_TIME) {
+      } else if (type[i] == CT_ISO8601_TIME || type[i] == CT_TIME_FMT) {
         SEXP tt = PROTECT(allocVector(STRSXP, 2));
         SET_STRING_ELT(tt, 0, char_POSIXct);
         SET_STRING_ELT(tt, 1, char_POSIXt);
@@ -512,27 +922,345 @@ size_t allocateDT(int8_t *typeArg, int8_t *sizeArg, int ncolArg, int ndrop, size
       SET_TRUELENGTH(thiscol, allocNrow);
       DTbytes += SIZEOF(thiscol)*allocNrow;
     }
+    if (nFiles && type[i]>0) multiType[i] = type[i];
     resi++;
   }
   dtnrows = allocNrow;
+  widenType = NULL;
   return DTbytes;
 }
 
+void widenRows(const int8_t *oldTypes, size_t nrows) {
+  widenType = oldTypes;
+  widenNrow = nrows;
+}
+
+
+typedef struct { SEXP s; int code; } levelCode;
+static int levelCmp(const void *a, const void *b) { return StrCmp(((const levelCode *)a)->s, ((const levelCode *)b)->s); }
+
+static void finalizeColumns(size_t nrow) {
+  // Done once on the first nrow rows, either for each batch or at the end:
+  //  * Sort the levels of each CT_FACTOR column as as_factor() at R level does, recode the rows in place and set the levels and
+  //    class attributes. The dictionary itself keeps the codes in order of first appearance for further batches.
+  //  * Convert CT_DECIMAL columns from scaled int64 to double in place, so the result does not depend on whether a value
+  //    outside the sample bumped the column to double. Division by the exact power of 10 is correctly rounded when the
+  //    scaled value is within 2^53.
+  for (int i=0, resi=0; i<ncol; i++) {
+    if (type[i]==CT_DROP) continue;
+    SEXP col = VECTOR_ELT(DT, resi++);
+    if (decimalCol[i]) {
+      const double p = pow(10.0, decimalScale[i]);
+      double *d = REAL(col);
+      const int64_t *v = (const int64_t *)d;
+      for (size_t r=0; r<nrow; r++) d[r] = v[r]==NA_INT64 ? NA_REAL : (double)v[r]/p;
+      continue;
+    }
+    if (!factorDict || factorDict[i].nlevels<0) continue;  // not type[i]==CT_FACTOR which is -CT_STRING after a reread of other columns
+    // the levels are those in these rows only, since a batch is a factor of its own rows as as_factor() would make it
+    SEXP levels = PROTECT(factorDictLevels(i));
+    const int n = LENGTH(levels);
+    int *codes = INTEGER(col);
+    int *map = (int *)R_alloc(n+1, sizeof(int));
+    memset(map, 0, (n+1)*sizeof(int));
+    for (size_t r=0; r<nrow; r++) if (codes[r]!=NA_INTEGER) map[codes[r]] = 1;
+    int nused = 0;
+    levelCode *lc = (levelCode *)R_alloc(n, sizeof(levelCode));
+    for (int k=0; k<n; k++) if (map[k+1]) { lc[nused].s = STRING_ELT(levels, k); lc[nused++].code = k+1; }
+    qsort(lc, nused, sizeof(levelCode), levelCmp);
+    SEXP sorted = PROTECT(allocVector(STRSXP, nused));
+    for (int k=0; k<nused; k++) { SET_STRING_ELT(sorted, k, lc[k].s); map[lc[k].code] = k+1; }
+    for (size_t r=0; r<nrow; r++) if (codes[r]!=NA_INTEGER) codes[r] = map[codes[r]];
+    setAttrib(col, R_LevelsSymbol, sorted);
+    setAttrib(col, R_ClassSymbol, ScalarString(char_factor));
+    UNPROTECT(2);
+  }
+}
+
 
 void setFinalNrow(size_t nrow) {
+  if (nFiles) {
+    REAL(fileRows)[fileIndex] = (double)nrow;
+    dtOffset += nrow;
+    if (fileIndex < nFiles-1) return;  // the next file is read into the rows after these; the columns are finalized after the last file
+    nrow = dtOffset;
+  }
+  // finalizeColumns() recodes and rescales in place so must see each row once. When streaming, consumeBatch() has done every
+  // batch including the last, whose rows are still in DT here; otherwise this is the only call. So no flag is needed to record
+  // that the rows so far are done, as there was when this also ran after the last batch.
+  if (isNull(batchFun)) finalizeColumns(nrow);
   if (selectRank) setcolorder(DT, selectRank);  // selectRank was changed to contain order (not rank) in allocateDT above
   if (length(DT)) {
     if (nrow == dtnrows)
       return;
     for (int i=0; i<LENGTH(DT); i++) {
-      SETLENGTH(VECTOR_ELT(DT,i), nrow);  // TODO: realloc
-      SET_TRUELENGTH(VECTOR_ELT(DT,i), nrow);
+      SEXP col = VECTOR_ELT(DT,i);
+      SETLENGTH(col, nrow);  // TODO: realloc
+#if R_VERSION >= R_Version(4, 5, 0)
+      SET_TRUELENGTH(col, nrow);  // R's API can't make this column resizable now; freadAppendR() reallocates it the first time
+#else
+      SET_TRUELENGTH(col, tailMode ? dtnrows : nrow);
+      // tail=: the rows appended next time can go in the rest, so R must know the allocation is the truelength
+      if (tailMode) SET_GROWABLE_BIT(col);
+#endif
     }
   }
   R_FlushConsole(); // # 2481. Just a convenient place; nothing per se to do with setFinalNrow()
 }
 
 
+bool consumeBatch(size_t nrow) {
+  // Pass the first nrow rows to the R function as a list in final column order. The columns are not copied: they are
+  // shortened for the duration of the call and then reused for the next batch, which is why ?fread says to copy() a batch to keep it.
+  // The R function (wrapped at R level) returns TRUE to continue, FALSE to stop, or a string error message from tryCatch
+  // so that the error is raised here via STOP which cleans up freadMain's state first.
+  finalizeColumns(nrow);
+  const int n = LENGTH(DT);
+  SEXP batch = PROTECT(allocVector(VECSXP, n));
+  for (int i=0; i<n; i++) {
+    SEXP col = VECTOR_ELT(DT, selectRank ? INTEGER(selectRank)[i]-1 : i);
+    SETLENGTH(col, nrow);
+    SET_VECTOR_ELT(batch, i, col);
+  }
+  SEXP names = getAttrib(DT, R_NamesSymbol);
+  setAttrib(batch, R_NamesSymbol, selectRank ? subsetVector(names, selectRank) : names);
+  setAttrib(batch, sym_colClassesAs, getAttrib(DT, sym_colClassesAs));  // already in final column order, see allocateDT
+  SEXP call = PROTECT(lang2(batchFun, batch));
+  SEXP ans = PROTECT(eval(call, R_GlobalEnv));
+  for (int i=0; i<n; i++) SETLENGTH(VECTOR_ELT(DT,i), dtnrows);
+  if (isString(ans) && LENGTH(ans)==1) STOP("%s", CHAR(STRING_ELT(ans,0)));
+  bool more = isLogical(ans) && LENGTH(ans)==1 && LOGICAL(ans)[0]==TRUE;
+  UNPROTECT(3);
+  return more;
+}
+
+
+static SEXP schemaSym(uint64_t key) {
+  char buf[17];
+  snprintf(buf, 17, "%016"PRIx64, key);
+  return install(buf);
+}
+
+bool getSchema(uint64_t key, freadSchema *schema) {
+  // Each schema is stored in schemaEnv as list(types=<integer>, layout=<integer>, lineLen=<double>); see putSchema below.
+  // Anything else under the key (e.g. from a sidecar file edited by hand) is treated as no schema.
+  SEXP s = findVarInFrame(schemaEnv, schemaSym(key));
+  if (s==R_UnboundValue || !isNewList(s) || LENGTH(s)!=3) return false;
+  SEXP types=VECTOR_ELT(s,0), layout=VECTOR_ELT(s,1), lineLen=VECTOR_ELT(s,2);
+  if (!isInteger(types) || !isInteger(layout) || LENGTH(layout)!=5 || !isReal(lineLen) || LENGTH(lineLen)!=2) return false;
+  const int n = LENGTH(types);
+  const int *t = INTEGER(types), *l = INTEGER(layout);
+  for (int j=0; j<n; j++) if (t[j]<CT_BOOL8_N || t[j]>=NUMTYPE) return false;
+  if (l[0]<1 || l[0]>127 || l[1]<0 || l[1]>3 || l[3]<0 || l[4]<0 || !(REAL(lineLen)[0]>0)) return false;
+  schema->ncol = n;
+  schema->types = (int8_t *)R_alloc(n, sizeof(int8_t));  // freed by R at the end of the .Call
+  for (int j=0; j<n; j++) schema->types[j] = (int8_t)t[j];
+  schema->sep = (char)l[0];
+  schema->quoteRule = (int8_t)l[1];
+  schema->header = l[2]!=0;
+  schema->topSkip = l[3];
+  schema->minLineLen = l[4];
+  schema->meanLineLen = REAL(lineLen)[0];
+  schema->sdLineLen = REAL(lineLen)[1];
+  return true;
+}
+
+void putSchema(uint64_t key, const freadSchema *schema) {
+  SEXP s = PROTECT(allocVector(VECSXP, 3));
+  SEXP types = SET_VECTOR_ELT(s, 0, allocVector(INTSXP, schema->ncol));
+  for (int j=0; j<schema->ncol; j++) INTEGER(types)[j] = schema->types[j];
+  SEXP layout = SET_VECTOR_ELT(s, 1, allocVector(INTSXP, 5));
+  int *l = INTEGER(layout);
+  l[0] = schema->sep; l[1] = schema->quoteRule; l[2] = schema->header; l[3] = schema->topSkip; l[4] = schema->minLineLen;
+  SEXP lineLen = SET_VECTOR_ELT(s, 2, allocVector(REALSXP, 2));
+  REAL(lineLen)[0] = schema->meanLineLen;
+  REAL(lineLen)[1] = schema->sdLineLen;
+  SEXP nms = PROTECT(allocVector(STRSXP, 3));
+  SET_STRING_ELT(nms, 0, mkChar("types"));
+  SET_STRING_ELT(nms, 1, mkChar("layout"));
+  SET_STRING_ELT(nms, 2, mkChar("lineLen"));
+  setAttrib(s, R_NamesSymbol, nms);
+  SEXP sym = schemaSym(key);
+  SEXP old = findVarInFrame(schemaEnv, sym);
+  // the line length statistics of a reused schema are kept as they were, so it is only marked modified when the types or layout change
+  if (old==R_UnboundValue || !isNewList(old) || LENGTH(old)!=3 ||
+      !R_compute_identical(VECTOR_ELT(old,0), types, 0) || !R_compute_identical(VECTOR_ELT(old,1), layout, 0)) {
+    defineVar(sym, s, schemaEnv);
+    defineVar(install(".modified"), ScalarLogical(TRUE), schemaEnv);
+  }
+  UNPROTECT(2);
+}
+
+static const char *rowIndexNames[] = {"types", "scale", "fmt", "layout", "firstRowOffset", "nrow", "row", "offset"};
+
+bool getRowIndex(freadRowIndex *ri) {
+  // The row index is stored in rowIndexEnv as `index`; see putRowIndex below. R level has checked that it was built from
+  // this file as it is now (its size and modification time) with the same arguments; anything malformed is treated as no row
+  // index. freadMain checks the layout numbers against this call's dateTimeFormats.
+  SEXP s = findVarInFrame(rowIndexEnv, install("index"));
+  if (s==R_UnboundValue || !isNewList(s) || LENGTH(s)!=8) return false;
+  SEXP types=VECTOR_ELT(s,0), scale=VECTOR_ELT(s,1), fmt=VECTOR_ELT(s,2), layout=VECTOR_ELT(s,3);
+  SEXP firstRowOffset=VECTOR_ELT(s,4), nrow=VECTOR_ELT(s,5), row=VECTOR_ELT(s,6), offset=VECTOR_ELT(s,7);
+  const int n = LENGTH(types);
+  if (!isInteger(types) || !isInteger(scale) || !isInteger(fmt) || LENGTH(scale)!=n || LENGTH(fmt)!=n ||
+      !isInteger(layout) || LENGTH(layout)!=3 || !isReal(firstRowOffset) || LENGTH(firstRowOffset)!=1 ||
+      !isReal(nrow) || LENGTH(nrow)!=1 || !isReal(row) || !isReal(offset) || LENGTH(row)!=LENGTH(offset) || LENGTH(row)<1) return false;
+  const int *t = INTEGER(types), *l = INTEGER(layout), *sc = INTEGER(scale), *fm = INTEGER(fmt);
+  for (int j=0; j<n; j++) if (t[j]<CT_BOOL8_N || t[j]>=NUMTYPE || sc[j]<0 || sc[j]>INT8_MAX || fm[j]<-1 || fm[j]>INT8_MAX) return false;
+  if (l[0]<1 || l[0]>127 || l[1]<0 || l[1]>3) return false;
+  ri->ncol = n;
+  ri->types = (int8_t *)R_alloc(n, sizeof(int8_t));  // freed by R at the end of the .Call
+  ri->scale = (int8_t *)R_alloc(n, sizeof(int8_t));
+  ri->fmt = (int8_t *)R_alloc(n, sizeof(int8_t));
+  for (int j=0; j<n; j++) {
+    ri->types[j] = (int8_t)t[j];
+    ri->scale[j] = (int8_t)sc[j];
+    ri->fmt[j] = (int8_t)fm[j];
+  }
+  ri->sep = (char)l[0];
+  ri->quoteRule = (int8_t)l[1];
+  ri->header = l[2]!=0;
+  ri->firstRowOffset = (int64_t)REAL(firstRowOffset)[0];
+  ri->nrow = (int64_t)REAL(nrow)[0];
+  ri->n = LENGTH(row);
+  ri->row = (int64_t *)R_alloc(ri->n, sizeof(int64_t));
+  ri->offset = (int64_t *)R_alloc(ri->n, sizeof(int64_t));
+  for (int64_t i=0; i<ri->n; i++) {
+    ri->row[i] = (int64_t)REAL(row)[i];
+    ri->offset[i] = (int64_t)REAL(offset)[i];
+    if (i ? ri->row[i]<=ri->row[i-1] || ri->offset[i]<=ri->offset[i-1] : ri->row[i]!=0) return false;
+  }
+  return true;
+}
+
+void putRowIndex(const freadRowIndex *ri) {
+  // Row numbers and offsets are kept as double, which is exact up to 2^53, so that the index is plain R data for saveRDS()
+  SEXP s = PROTECT(allocVector(VECSXP, 8));
+  SEXP types = SET_VECTOR_ELT(s, 0, allocVector(INTSXP, ri->ncol));
+  SEXP scale = SET_VECTOR_ELT(s, 1, allocVector(INTSXP, ri->ncol));
+  SEXP fmt = SET_VECTOR_ELT(s, 2, allocVector(INTSXP, ri->ncol));
+  for (int j=0; j<ri->ncol; j++) {
+    INTEGER(types)[j] = ri->types[j];
+    INTEGER(scale)[j] = ri->scale[j];
+    INTEGER(fmt)[j] = ri->fmt[j];
+  }
+  SEXP layout = SET_VECTOR_ELT(s, 3, allocVector(INTSXP, 3));
+  INTEGER(layout)[0] = ri->sep; INTEGER(layout)[1] = ri->quoteRule; INTEGER(layout)[2] = ri->header;
+  SET_VECTOR_ELT(s, 4, ScalarReal((double)ri->firstRowOffset));
+  SET_VECTOR_ELT(s, 5, ScalarReal((double)ri->nrow));
+  SEXP row = SET_VECTOR_ELT(s, 6, allocVector(REALSXP, ri->n));
+  SEXP offset = SET_VECTOR_ELT(s, 7, allocVector(REALSXP, ri->n));
+  for (int64_t i=0; i<ri->n; i++) {
+    REAL(row)[i] = (double)ri->row[i];
+    REAL(offset)[i] = (double)ri->offset[i];
+  }
+  SEXP nms = PROTECT(allocVector(STRSXP, 8));
+  for (int i=0; i<8; i++) SET_STRING_ELT(nms, i, mkChar(rowIndexNames[i]));
+  setAttrib(s, R_NamesSymbol, nms);
+  defineVar(install("index"), s, rowIndexEnv);
+  UNPROTECT(2);
+}
+
+// Growable columns for freadAppendR(). From R 4.5.0 these are R's resizable vectors; SET_GROWABLE_BIT is not part of R's API.
+// Before that, the spare capacity is the truelength as it is for over-allocated data.tables.
+static SEXP allocGrowable(SEXPTYPE type, R_len_t n, R_len_t cap) {
+#if R_VERSION >= R_Version(4, 5, 0)
+  SEXP ans = R_allocResizableVector(type, cap);
+  R_resizeVector(ans, n);
+#else
+  SEXP ans = allocVector(type, cap);
+  SETLENGTH(ans, n);
+  SET_TRUELENGTH(ans, cap);
+  SET_GROWABLE_BIT(ans);
+#endif
+  return ans;
+}
+
+static R_len_t growableCapacity(SEXP x) {
+#if R_VERSION >= R_Version(4, 5, 0)
+  return R_isResizable(x) ? (R_len_t)R_maxLength(x) : 0;
+#else
+  return TRUELENGTH(x);
+#endif
+}
+
+static void setGrowableLength(SEXP x, R_len_t n) {
+#if R_VERSION >= R_Version(4, 5, 0)
+  R_resizeVector(x, n);
+#else
+  SETLENGTH(x, n);
+#endif
+}
+
+SEXP freadAppendR(SEXP dt, SEXP add) {
+  // tail=DT at R level: append the new rows in `add` to the columns of dt by reference. A column grows in place when it has
+  // room (see allocGrowable above, and setFinalNrow which leaves room before R 4.5.0) and nothing else refers to it, otherwise
+  // it is reallocated with half as much again spare; e.g. after `a = DT$a`, a keeps the rows it had. R level has checked that
+  // the columns match by name, type and attributes.
+  if (!isNewList(dt) || !isNewList(add) || LENGTH(dt)!=LENGTH(add)) error(_("Internal error: freadAppendR was not passed two lists of the same length"));  // # nocov
+  for (int j=0; j<LENGTH(dt); j++) {
+    SEXP col = VECTOR_ELT(dt, j), new = VECTOR_ELT(add, j);
+    if (TYPEOF(col)!=TYPEOF(new)) error(_("Internal error: freadAppendR column %d is type '%s' but the new rows are type '%s'"), j+1, type2char(TYPEOF(col)), type2char(TYPEOF(new)));  // # nocov
+    const R_len_t n = LENGTH(col), nadd = LENGTH(new);
+    if (nadd==0) continue;
+    if ((int64_t)n+nadd > INT_MAX) error(_("Appending %d rows to the %d already read would exceed the maximum number of rows of a column, %d"), nadd, n, INT_MAX);
+    const R_len_t need = n+nadd;
+    if (ALTREP(col) || growableCapacity(col)<need || MAYBE_SHARED(col)) {
+      const R_len_t cap = need + (R_len_t)(need/2 < INT_MAX-need ? need/2 : INT_MAX-need);
+      SEXP grown = PROTECT(allocGrowable(TYPEOF(col), n, cap));
+      if (isString(col)) for (R_len_t i=0; i<n; i++) SET_STRING_ELT(grown, i, STRING_ELT(col, i));
+      else if (isNewList(col)) for (R_len_t i=0; i<n; i++) SET_VECTOR_ELT(grown, i, VECTOR_ELT(col, i));
+      else if (n) memcpy(DATAPTR(grown), DATAPTR_RO(col), (size_t)n*SIZEOF(col));
+      copyMostAttrib(col, grown);
+      SET_VECTOR_ELT(dt, j, grown);
+      UNPROTECT(1);
+      col = grown;
+    }
+    setGrowableLength(col, need);
+    if (isString(col)) for (R_len_t i=0; i<nadd; i++) SET_STRING_ELT(col, n+i, STRING_ELT(new, i));
+    else if (isNewList(col)) for (R_len_t i=0; i<nadd; i++) SET_VECTOR_ELT(col, n+i, VECTOR_ELT(new, i));
+    else memcpy((char *)DATAPTR(col) + (size_t)n*SIZEOF(col), DATAPTR_RO(new), (size_t)nadd*SIZEOF(col));
+  }
+  return dt;
+}
+
+
+static int dedupStrings(lenOff *source, int cnt8, const char *anchor, int nRows, int *first, int *table, int tableMask)
+{
+  // Finds the first row in this chunk with the same string as each row, so that mkCharLenCE is called once per distinct
+  // string in the chunk in pushBuffer's critical section rather than once per cell. Runs in parallel before the critical.
+  // Embedded nul are removed here too, see below. first[i] is -1 for NA and "", i for the first occurrence, else the earlier row.
+  // table holds row+1 (0 is empty) and must be zero on entry. Returns the number of distinct strings.
+  int nDistinct = 0;
+  for (int i=0; i<nRows; i++, source+=cnt8) {
+    int strLen = source->len;
+    if (strLen<=0) { first[i] = -1; continue; }
+    const char *str = anchor + source->off;
+    int c=0;
+    while (c<strLen && str[c]) c++;
+    if (c<strLen) {
+      // embedded nul found; any at the beginning or the end of the field should have already been excluded but this will strip those too if present just in case
+      char *last = (char *)str+c;    // obtain write access to (const char *)anchor;
+      while (c<strLen) {
+        if (str[c]) *last++=str[c];  // cow page write: saves allocation and management of a temp that would need to thread-safe in future.
+        c++;                         //   This is only thread accessing this region. For non-mmap direct input nul are not possible (R would not have accepted nul earlier).
+      }
+      source->len = strLen = last-str;
+    }
+    uint32_t h = 2166136261u ^ (uint32_t)strLen;
+    for (int k=0; k<strLen; k++) h = (h ^ (uint8_t)str[k]) * 16777619u;
+    int slot = (int)(h & (uint32_t)tableMask);
+    for (;;) {
+      int r = table[slot];
+      if (r==0) { table[slot] = i+1; first[i] = i; nDistinct++; break; }
+      const lenOff *prev = source - (int64_t)(i-(r-1))*cnt8;
+      if (prev->len==strLen && memcmp(anchor+prev->off, str, strLen)==0) { first[i] = r-1; break; }
+      slot = (slot+1) & tableMask;
+    }
+  }
+  return nDistinct;
+}
+
 void pushBuffer(ThreadLocalFreadParsingContext *ctx)
 {
   const void *buff8 = ctx->buff8;
@@ -540,7 +1268,7 @@ void pushBuffer(ThreadLocalFreadParsingContext *ctx)
   const void *buff1 = ctx->buff1;
   const char *anchor = ctx->anchor;
   int nRows = (int) ctx->nRows;
-  size_t DTi = ctx->DTi;
+  size_t DTi = ctx->DTi + dtOffset;
   int rowSize8 = (int) ctx->rowSize8;
   int rowSize4 = (int) ctx->rowSize4;
   int rowSize1 = (int) ctx->rowSize1;
@@ -555,34 +1283,89 @@ void pushBuffer(ThreadLocalFreadParsingContext *ctx)
 
   // the byte position of this column in the first row of the row-major buffer
   if (nStringCols) {
+    int cnt8 = rowSize8 / 8;
+    lenOff *buff8_lenoffs = (lenOff*) buff8;
+    // Dedup each string column within this chunk outside the critical, in parallel. If the memory isn't available, every
+    // string is passed to mkCharLenCE as before (first==NULL) and embedded nul are removed inside the critical instead.
+    int tableMask = 1;
+    while (tableMask < 2*nRows) tableMask <<= 1;
+    int *first = (int *)malloc((size_t)nStringCols * nRows * sizeof(int));
+    int *table = first ? (int *)calloc((size_t)tableMask, sizeof(int)) : NULL;
+    tableMask--;
+    if (!table) { free(first); first = NULL; }
+    int *nDistinct = first ? (int *)malloc((size_t)nStringCols * sizeof(int)) : NULL;
+    if (first && !nDistinct) { free(first); first = NULL; }
+    if (first) {
+      int off8 = 0;
+      for (int j=0, done=0; done<nStringCols && j<ncol; j++) {
+        if (type[j] == CT_DROP) continue;
+        if (type[j] >= CT_STRING) {
+          if (done) memset(table, 0, ((size_t)tableMask+1)*sizeof(int));
+          nDistinct[done] = dedupStrings(buff8_lenoffs + off8, cnt8, anchor, nRows, first + (size_t)done*nRows, table, tableMask);
+          done++;
+        }
+        off8 += (size[j] == 8);
+      }
+    }
+    free(table);
     #pragma omp critical
     {
       int off8 = 0;
-      int cnt8 = rowSize8 / 8;
-      lenOff *buff8_lenoffs = (lenOff*) buff8;
       for (int j=0, resj=-1, done=0; done<nStringCols && j<ncol; j++) {
         if (type[j] == CT_DROP) continue;
         resj++;
-        if (type[j] == CT_STRING) {
+        if (type[j] == CT_FACTOR) {
+          int *dest = INTEGER(VECTOR_ELT(DT, resj)) + DTi;
+          lenOff *source = buff8_lenoffs + off8;
+          const int *firstj = first ? first + (size_t)done*nRows : NULL;
+          for (int i=0; i<nRows; i++, source+=cnt8) {
+            int strLen = source->len;
+            if (strLen<0) dest[i] = NA_INTEGER;
+            else if (firstj && firstj[i]>=0 && firstj[i]<i) dest[i] = dest[firstj[i]];
+            else {
+              const char *str = anchor + source->off;
+              if (!first) {
+                int c=0;
+                while (c<strLen && str[c]) c++;
+                if (c<strLen) {
+                  char *last = (char *)str+c;  // embedded nul; see dedupStrings()
+                  while (c<strLen) { if (str[c]) *last++=str[c]; c++; }
+                  strLen = last-str;
+                }
+              }
+              dest[i] = factorCode(j, str, strLen);
+            }
+          }
+          done++;
+        } else if (type[j] == CT_STRING) {
           SEXP dest = VECTOR_ELT(DT, resj);
           lenOff *source = buff8_lenoffs + off8;
+          const int *firstj = first ? first + (size_t)done*nRows : NULL;
+          // a column of mostly distinct strings (e.g. ids) gains nothing from reusing the CHARSXP of an earlier row
+          if (firstj && nDistinct[done] > nRows/2) firstj = NULL;
           for (int i=0; i<nRows; i++) {
             int strLen = source->len;
             if (strLen<=0) {
               // stringLen == INT_MIN => NA, otherwise not a NAstring was checked inside fread_mean
-              if (strLen<0) SET_STRING_ELT(dest, DTi+i, NA_STRING); // else leave the "" in place that was initialized by allocVector()
+              if (strLen<0) SET_STRING_ELT(dest, DTi+i, NA_STRING);
+              else if (!isNull(batchFun)) SET_STRING_ELT(dest, DTi+i, R_BlankString);  // streaming reuses the columns for each batch
+              // else leave the "" in place that was initialized by allocVector()
+            } else if (firstj && firstj[i]<i) {
+              SET_STRING_ELT(dest, DTi+i, STRING_ELT(dest, DTi+firstj[i]));  // same string as an earlier row in this chunk
             } else {
               const char *str = anchor + source->off;
-              int c=0;
-              while (c<strLen && str[c]) c++;
-              if (c<strLen) {
-                // embedded nul found; any at the beginning or the end of the field should have already been excluded but this will strip those too if present just in case
-                char *last = (char *)str+c;    // obtain write access to (const char *)anchor;
-                while (c<strLen) {
-                  if (str[c]) *last++=str[c];  // cow page write: saves allocation and management of a temp that would need to thread-safe in future.
-                  c++;                         //   This is only thread accessing this region. For non-mmap direct input nul are not possible (R would not have accepted nul earlier).
+              if (!first) {
+                int c=0;
+                while (c<strLen && str[c]) c++;
+                if (c<strLen) {
+                  // embedded nul found; see dedupStrings()
+                  char *last = (char *)str+c;
+                  while (c<strLen) {
+                    if (str[c]) *last++=str[c];
+                    c++;
+                  }
+                  strLen = last-str;
                 }
-                strLen = last-str;
               }
               SET_STRING_ELT(dest, DTi+i, mkCharLenCE(str, strLen, ienc));
             }
@@ -593,6 +1376,8 @@ void pushBuffer(ThreadLocalFreadParsingContext *ctx)
         off8 += (size[j] == 8);
       }
     }
+    free(first);
+    free(nDistinct);
   }
 
   int off1 = 0, off4 = 0, off8 = 0;
@@ -600,7 +1385,7 @@ void pushBuffer(ThreadLocalFreadParsingContext *ctx)
     if (type[j]==CT_DROP) continue;
     int thisSize = size[j];
     resj++;
-    if (type[j]!=CT_STRING && type[j]>0) {
+    if (type[j]>0 && type[j]<CT_STRING) {
       if (thisSize == 8) {
         double *dest = (double *)REAL(VECTOR_ELT(DT, resj)) + DTi;
         const char *src8 = (char*)buff8 + off8;
@@ -7,9 +7,13 @@
 #include <math.h>      // isfinite, isnan
 #include <stdlib.h>    // abs
 #include <string.h>    // strlen, strerror
+#include <limits.h>    // INT_MIN
 #ifndef NOZLIB
 #include <zlib.h>      // for compression to .gz
 #endif
+#ifndef NOZSTD
+#include <zstd.h>      // for compression to .zst
+#endif
 
 #ifdef WIN32
 #include <sys/types.h>
@@ -42,6 +46,7 @@ static bool qmethodEscape=false;       // when quoting fields, how to escape dou
 static int scipen;
 static bool squashDateTime=false;      // 0=ISO(yyyy-mm-dd) 1=squash(yyyymmdd)
 static bool verbose=false;
+static fwriteBuffer *mem=NULL;         // args.buffer; when not NULL the file descriptor f is -2
 
 extern const char *getString(const void *, int64_t);
 extern int getStringLen(const void *, int64_t);
@@ -555,7 +560,7 @@ void writeCategString(const void *col, int64_t row, char **pch)
 }
 
 #ifndef NOZLIB
-int init_stream(z_stream *stream) {
+int init_stream(z_stream *stream, int level) {
   memset(stream, 0, sizeof(z_stream)); // shouldn't be needed, done as part of #4099 to be sure
   stream->next_in = Z_NULL;
   stream->zalloc = Z_NULL;
@@ -563,7 +568,7 @@ int init_stream(z_stream *stream) {
   stream->opaque = Z_NULL;
 
   // 31 comes from : windows bits 15 | 16 gzip format
-  int err = deflateInit2(stream, Z_DEFAULT_COMPRESSION, Z_DEFLATED, 31, 8, Z_DEFAULT_STRATEGY);
+  int err = deflateInit2(stream, level, Z_DEFLATED, 31, 8, Z_DEFAULT_STRATEGY);
   return err;  // # nocov
 }
 
@@ -583,6 +588,62 @@ int compressbuff(z_stream *stream, void* dest, size_t *destLen, const void* sour
 }
 #endif
 
+static int writeOut(int f, const void *buf, size_t n) {
+  // write() to the file, or append to mem when f==-2
+  if (f!=-2) return WRITE(f, buf, (int)n);
+  if (mem->len+n > mem->cap) {
+    size_t cap = MAX(2*mem->cap, mem->len+n);
+    char *p = realloc(mem->data, cap);
+    if (!p) { errno=ENOMEM; return -1; }  // # nocov
+    mem->data = p;
+    mem->cap = cap;
+  }
+  memcpy(mem->data+mem->len, buf, n);
+  mem->len += n;
+  return (int)n;
+}
+#ifndef NOZSTD
+// Each batch is an independent zstd frame. After them a skippable frame holds the seek table of the zstd seekable format
+// (contrib/seekable_format in the zstd sources): the compressed and decompressed size of each frame, so that a reader can
+// find any row range and decompress the frames in parallel. Other zstd decoders skip it.
+#define ZSTD_SKIPPABLE_MAGIC 0x184D2A5E
+#define ZSTD_SEEKABLE_MAGIC  0x8F92EAB1
+
+static void write_le32(uint32_t x, char **pch) {
+  unsigned char *ch = (unsigned char *)*pch;
+  ch[0]=x&0xFF; ch[1]=(x>>8)&0xFF; ch[2]=(x>>16)&0xFF; ch[3]=x>>24;
+  *pch += 4;
+}
+
+static int write_seek_table(int f, const uint32_t *frameSizes, int nFrames) {
+  // frameSizes holds the compressed then the decompressed size of each frame in turn
+  size_t len = 8/*skippable frame header*/ + (size_t)nFrames*8 + 9/*footer*/;
+  char *buff = malloc(len), *ch = buff;
+  if (!buff) return -1;  // # nocov
+  write_le32(ZSTD_SKIPPABLE_MAGIC, &ch);
+  write_le32((uint32_t)(len-8), &ch);
+  for (int i=0; i<2*nFrames; i++) write_le32(frameSizes[i], &ch);
+  write_le32((uint32_t)nFrames, &ch);
+  *ch++ = 0;  // Seek_Table_Descriptor: no checksums
+  write_le32(ZSTD_SEEKABLE_MAGIC, &ch);
+  int ret = writeOut(f, buff, len);
+  free(buff);
+  return ret;
+}
+#endif
+
+static int openOut(const char *filename, bool append) {
+  // returns the file descriptor, or -1 with errno set
+#ifdef WIN32
+  return _open(filename, _O_WRONLY | _O_BINARY | _O_CREAT | (append ? _O_APPEND : _O_TRUNC), _S_IWRITE);
+  // O_BINARY rather than O_TEXT for explicit control and speed since it seems that write() has a branch inside it
+  // to convert \n to \r\n on Windows when in text mode not not when in binary mode.
+#else
+  return open(filename, O_WRONLY | O_CREAT | (append ? O_APPEND : O_TRUNC), 0666);
+  // There is no binary/text mode distinction on Linux and Mac
+#endif
+}
+
 void fwriteMain(fwriteMainArgs args)
 {
   double startTime = wallclock();
@@ -595,6 +656,7 @@ void fwriteMain(fwriteMainArgs args)
   scipen = args.scipen;
   doQuote = args.doQuote;
   verbose = args.verbose;
+  mem = args.buffer;
 
   // When NA is a non-empty string, then we must quote all string fields in case they contain the na string
   // na is recommended to be empty, though
@@ -663,20 +725,39 @@ void fwriteMain(fwriteMainArgs args)
   }
   if (verbose) DTPRINT(_("maxLineLen=%"PRIu64". Found in %.3fs\n"), (uint64_t)maxLineLen, 1.0*(wallclock()-t0));
 
+#ifdef NOZSTD
+  if (args.compress==FW_COMPRESS_ZSTD)
+    STOP(_("Compression to zstd in fwrite uses the zstd library. Its header files were not found at the time data.table was compiled. To enable it, please install libzstd (e.g. deb: libzstd-dev, rpm: libzstd-devel), reinstall data.table and study the output for further guidance.")); // # nocov
+#endif
+  int level = args.compressLevel;
+  if (args.compress==FW_COMPRESS_GZIP) {
+    if (level==INT_MIN) level = 6;  // zlib's Z_DEFAULT_COMPRESSION
+    else if (level<0 || level>9) STOP(_("compressLevel=%d is outside the range [0,9] of gzip"), level);
+  }
+#ifndef NOZSTD
+  else if (args.compress==FW_COMPRESS_ZSTD) {
+    if (level==INT_MIN) level = 3;  // zstd's ZSTD_CLEVEL_DEFAULT
+    else if (level<1 || level>ZSTD_maxCLevel()) STOP(_("compressLevel=%d is outside the range [1,%d] of zstd"), level, ZSTD_maxCLevel());
+  }
+#endif
+
+#ifdef NOZLIB
+  if (args.compress==FW_COMPRESS_GZIP)
+    STOP(_("Compression in fwrite uses zlib library. Its header files were not found at the time data.table was compiled. To enable fwrite compression, please reinstall data.table and study the output for further guidance.")); // # nocov
+#endif
+
+  // From here, each STOP closes f first: on fwrite(async=TRUE)'s thread STOP longjmps back, so f would not be closed otherwise
   int f=0;
-  if (*args.filename=='\0') {
+  if (mem) {
+    f=-2;  // write to memory
+  } else if (args.nPart) {
+    f=-3;  // each partition's file is opened in the ordered section when its first batch is written
+  } else if (*args.filename=='\0') {
     f=-1;  // file="" means write to standard output
-    args.is_gzip = false; // gzip is only for file
+    args.compress = FW_COMPRESS_NONE; // compression is only for file
     // eol = "\n";  // We'll use DTPRINT which converts \n to \r\n inside it on Windows
   } else {
-#ifdef WIN32
-    f = _open(args.filename, _O_WRONLY | _O_BINARY | _O_CREAT | (args.append ? _O_APPEND : _O_TRUNC), _S_IWRITE);
-    // O_BINARY rather than O_TEXT for explicit control and speed since it seems that write() has a branch inside it
-    // to convert \n to \r\n on Windows when in text mode not not when in binary mode.
-#else
-    f = open(args.filename, O_WRONLY | O_CREAT | (args.append ? O_APPEND : O_TRUNC), 0666);
-    // There is no binary/text mode distinction on Linux and Mac
-#endif
+    f = openOut(args.filename, args.append);
     if (f == -1) {
       // # nocov start
       int erropen = errno;
@@ -687,10 +768,6 @@ void fwriteMain(fwriteMainArgs args)
       // # nocov end
     }
   }
-#ifdef NOZLIB
-  if (args.is_gzip)
-    STOP(_("Compression in fwrite uses zlib library. Its header files were not found at the time data.table was compiled. To enable fwrite compression, please reinstall data.table and study the output for further guidance.")); // # nocov
-#endif
 
   int yamlLen = strlen(args.yaml);
   if (verbose) {
@@ -699,6 +776,9 @@ void fwriteMain(fwriteMainArgs args)
     if (f==-1) DTPRINT(_("\n"));
   }
   size_t headerLen = 0;
+  uint32_t headerFrame[2] = {0, 0};  // zstd: the sizes of the frame holding the header, if any, for the seek table
+  char *header = NULL;      // partitioned: the header as written (compressed if need be), kept to begin each partition's file
+  size_t headerBytes = 0;
   if (args.bom) headerLen += 3;
   headerLen += yamlLen;
   if (args.colNames) {
@@ -707,7 +787,10 @@ void fwriteMain(fwriteMainArgs args)
   }
   if (headerLen) {
     char *buff = malloc(headerLen);
-    if (!buff) STOP(_("Unable to allocate %d MiB for header: %s"), headerLen / 1024 / 1024, strerror(errno));
+    if (!buff) {
+      if (f>=0) CLOSE(f);                                                                          // # nocov
+      STOP(_("Unable to allocate %d MiB for header: %s"), headerLen / 1024 / 1024, strerror(errno));  // # nocov
+    }
     char *ch = buff;
     if (args.bom) {*ch++=(char)0xEF; *ch++=(char)0xBB; *ch++=(char)0xBF; }  // 3 appears above (search for "bom")
     memcpy(ch, args.yaml, yamlLen);
@@ -731,11 +814,13 @@ void fwriteMain(fwriteMainArgs args)
       free(buff);
     } else {
       int ret1=0, ret2=0;
-      if (args.is_gzip) {
+      char *out = buff;
+      size_t outLen = (size_t)(ch-buff);
+      if (args.compress==FW_COMPRESS_GZIP) {
 #ifndef NOZLIB
         z_stream stream = {0};
-        if(init_stream(&stream)) {
-          free(buff);                                    // # nocov
+        if(init_stream(&stream, level)) {
+          free(buff); if (f>=0) CLOSE(f);                // # nocov
           STOP(_("Can't allocate gzip stream structure"));  // # nocov
         }
         // by default, buffsize is the same used for writing rows (#5048 old openbsd zlib)
@@ -743,23 +828,46 @@ void fwriteMain(fwriteMainArgs args)
         size_t zbuffSize = deflateBound(&stream, headerLen > buffSize ? headerLen : buffSize);
         char *zbuff = malloc(zbuffSize);
         if (!zbuff) {
-          free(buff);                                                                                   // # nocov
+          free(buff); if (f>=0) CLOSE(f);                                                               // # nocov
           STOP(_("Unable to allocate %d MiB for zbuffer: %s"), zbuffSize / 1024 / 1024, strerror(errno));  // # nocov
         }
         size_t zbuffUsed = zbuffSize;
         ret1 = compressbuff(&stream, zbuff, &zbuffUsed, buff, (size_t)(ch-buff));
-        if (ret1==Z_OK) ret2 = WRITE(f, zbuff, (int)zbuffUsed);
         deflateEnd(&stream);
-        free(zbuff);
+        out = zbuff;
+        outLen = zbuffUsed;
+#endif
+      } else if (args.compress==FW_COMPRESS_ZSTD) {
+#ifndef NOZSTD
+        size_t zbuffSize = ZSTD_compressBound((size_t)(ch-buff));
+        char *zbuff = malloc(zbuffSize);
+        if (!zbuff) {
+          free(buff); if (f>=0) CLOSE(f);                                                               // # nocov
+          STOP(_("Unable to allocate %d MiB for zbuffer: %s"), zbuffSize / 1024 / 1024, strerror(errno));  // # nocov
+        }
+        size_t zbuffUsed = ZSTD_compress(zbuff, zbuffSize, buff, (size_t)(ch-buff), level);
+        if (ZSTD_isError(zbuffUsed)) {
+          // # nocov start
+          free(zbuff); free(buff); if (f>=0) CLOSE(f);
+          STOP(_("Compress zstd error: %s"), ZSTD_getErrorName(zbuffUsed));
+          // # nocov end
+        }
+        headerFrame[0] = (uint32_t)zbuffUsed;
+        headerFrame[1] = (uint32_t)(ch-buff);
+        out = zbuff;
+        outLen = zbuffUsed;
 #endif
-      } else {
-        ret2 = WRITE(f,  buff, (int)(ch-buff));
       }
-      free(buff);
+      if (ret1==0) {
+        if (args.nPart) { header = out; headerBytes = outLen; }
+        else ret2 = writeOut(f, out, outLen);
+      }
+      if (out!=buff && out!=header) free(out);
+      if (buff!=header) free(buff);
       if (ret1 || ret2==-1) {
         // # nocov start
         int errwrite = errno; // capture write errno now incase close fails with a different errno
-        CLOSE(f);
+        if (f>=0) CLOSE(f);
         if (ret1) STOP(_("Compress gzip error: %d"), ret1);
         else      STOP(_("%s: '%s'"), strerror(errwrite), args.filename);
         // # nocov end
@@ -769,7 +877,18 @@ void fwriteMain(fwriteMainArgs args)
   if (verbose) DTPRINT(_("done in %.3fs\n"), 1.0*(wallclock()-t0));
   if (args.nrow == 0) {
     if (verbose) DTPRINT(_("No data rows present (nrow==0)\n"));
-    if (f!=-1 && CLOSE(f)) STOP(_("%s: '%s'"), strerror(errno), args.filename);
+#ifndef NOZSTD
+    if (args.compress==FW_COMPRESS_ZSTD && write_seek_table(f, headerFrame, headerFrame[1]>0)==-1) {
+      int errwrite = errno;                                     // # nocov
+      if (f>=0) CLOSE(f);                                       // # nocov
+      STOP(_("%s: '%s'"), strerror(errwrite), args.filename);  // # nocov
+    }
+#endif
+    if (f>=0 && CLOSE(f)) STOP(_("%s: '%s'"), strerror(errno), args.filename);
+    if (mem && mem->flush && mem->flush(mem)) {
+      if (mem->msg[0]) STOP(_("Failed to write to %s: %s"), args.filename, mem->msg);
+      STOP(_("Failed to write to %s"), args.filename);  // # nocov
+    }
     return;
   }
 
@@ -783,11 +902,33 @@ void fwriteMain(fwriteMainArgs args)
   if (rowsPerBatch > args.nrow) rowsPerBatch = args.nrow;
   if (rowsPerBatch < 1) rowsPerBatch = 1;
   int numBatches = (args.nrow-1)/rowsPerBatch + 1;
+  int64_t *batchStart = NULL;  // partitioned: batch b writes rows [batchStart[b], batchStart[b+1]) to partition batchPart[b]
+  int *batchPart = NULL;
+  if (args.nPart) {
+    numBatches = 0;
+    for (int p=0; p<args.nPart; p++) numBatches += (args.partStart[p+1]-args.partStart[p]-1)/rowsPerBatch + 1;
+    batchStart = malloc(((size_t)numBatches+1)*sizeof(int64_t));
+    batchPart = malloc((size_t)numBatches*sizeof(int));
+    if (!batchStart || !batchPart) {
+      // # nocov start
+      free(batchStart); free(batchPart); free(header);
+      STOP(_("Unable to allocate the %d batches of %d partitions"), numBatches, args.nPart);
+      // # nocov end
+    }
+    for (int p=0, b=0; p<args.nPart; p++) {
+      for (int64_t start=args.partStart[p]; start<args.partStart[p+1]; start+=rowsPerBatch) {
+        batchStart[b] = start;
+        batchPart[b++] = p;
+      }
+    }
+    batchStart[numBatches] = args.nrow;
+  }
   int nth = args.nth;
   if (numBatches < nth) nth = numBatches;
   if (verbose) {
     DTPRINT(_("Writing %"PRId64" rows in %d batches of %d rows (each buffer size %dMB, showProgress=%d, nth=%d)\n"),
             args.nrow, numBatches, rowsPerBatch, args.buffMB, args.showProgress, nth);
+    if (args.nPart) DTPRINT(_("to %d partitions in '%s'\n"), args.nPart, args.filename);
   }
   t0 = wallclock();
 
@@ -796,14 +937,21 @@ void fwriteMain(fwriteMainArgs args)
 
   // compute zbuffSize which is the same for each thread
   size_t zbuffSize = 0;
-  if(args.is_gzip){
+  if(args.compress==FW_COMPRESS_GZIP){
 #ifndef NOZLIB
     z_stream stream = {0};
-    if(init_stream(&stream))
-      STOP(_("Can't allocate gzip stream structure")); // # nocov
+    if(init_stream(&stream, level)) {
+      free(batchStart); free(batchPart); free(header); if (f>=0) CLOSE(f);  // # nocov
+      STOP(_("Can't allocate gzip stream structure"));                      // # nocov
+    }
     zbuffSize = deflateBound(&stream, buffSize);
     if (verbose) DTPRINT(_("zbuffSize=%d returned from deflateBound\n"), (int)zbuffSize);
     deflateEnd(&stream);
+#endif
+  } else if (args.compress==FW_COMPRESS_ZSTD) {
+#ifndef NOZSTD
+    zbuffSize = ZSTD_compressBound(buffSize);
+    if (verbose) DTPRINT(_("zbuffSize=%d returned from ZSTD_compressBound at level %d\n"), (int)zbuffSize, level);
 #endif
   }
 
@@ -811,27 +959,40 @@ void fwriteMain(fwriteMainArgs args)
   char *buffPool = malloc(nth*(size_t)buffSize);
   if (!buffPool) {
     // # nocov start
+    free(batchStart); free(batchPart); free(header); if (f>=0) CLOSE(f);
     STOP(_("Unable to allocate %d MB * %d thread buffers; '%d: %s'. Please read ?fwrite for nThread, buffMB and verbose options."),
          (size_t)buffSize/(1024^2), nth, errno, strerror(errno));
     // # nocov end
   }
   char *zbuffPool = NULL;
-  if (args.is_gzip) {
+  if (args.compress!=FW_COMPRESS_NONE) {
     zbuffPool = malloc(nth*(size_t)zbuffSize);
-#ifndef NOZLIB
     if (!zbuffPool) {
       // # nocov start
-      free(buffPool);
+      free(buffPool); free(batchStart); free(batchPart); free(header); if (f>=0) CLOSE(f);
       STOP(_("Unable to allocate %d MB * %d thread compressed buffers; '%d: %s'. Please read ?fwrite for nThread, buffMB and verbose options."),
          (size_t)zbuffSize/(1024^2), nth, errno, strerror(errno));
       // # nocov end
     }
-#endif
+  }
+  uint32_t *frameSizes = NULL;  // zstd: the compressed and decompressed size of each frame written, for the seek table
+  int nFrames = 0;
+  if (args.compress==FW_COMPRESS_ZSTD) {
+    frameSizes = malloc(((size_t)numBatches+1)*2*sizeof(uint32_t));
+    if (!frameSizes) {
+      // # nocov start
+      free(buffPool); free(zbuffPool); free(batchStart); free(batchPart); free(header); if (f>=0) CLOSE(f);
+      STOP(_("Unable to allocate the zstd seek table of %d frames"), numBatches+1);
+      // # nocov end
+    }
+    if (headerFrame[1]) { frameSizes[0] = headerFrame[0]; frameSizes[1] = headerFrame[1]; nFrames = 1; }
   }
 
   bool failed = false;   // naked (unprotected by atomic) write to bool ok because only ever write true in this special paradigm
   int failed_compress = 0; // the first thread to fail writes their reason here when they first get to ordered section
   int failed_write = 0;    // same. could use +ve and -ve in the same code but separate it out to trace Solaris problem, #3931
+  bool failed_flush = false;  // the buffer's flush() failed, having reported why
+  const char *failed_file = args.filename;  // partitioned: the file being written when a write failed
 
 #ifndef NOZLIB
   z_stream thread_streams[nth];
@@ -839,137 +1000,211 @@ void fwriteMain(fwriteMainArgs args)
   // not declared inside the parallel region because solaris appears to move the struct in
   // memory when the #pragma omp for is entered, which causes zlib's internal self reference
   // pointer to mismatch, #4099
+#endif
+#if !defined(NOZLIB) || !defined(NOZSTD)
   char failed_msg[1001] = "";  // to hold zlib's msg; copied out of zlib in ordered section just in case the msg is allocated within zlib
 #endif
 
-  #pragma omp parallel num_threads(nth)
-  {
-    int me = omp_get_thread_num();
-    int my_failed_compress = 0;
-    char *ch, *myBuff;
-    ch = myBuff = buffPool + me*buffSize;
-
-    void *myzBuff = NULL;
-    size_t myzbuffUsed = 0;
+  // When the buffer is flushed, the rows are written in windows of 4 batches per thread so that flush() is called from
+  // this thread outside the parallel region while the buffer holds at most a window; otherwise in one window of all batches
+  const int batchesPerWindow = mem && mem->flush ? nth*4 : numBatches;
+  for (int from=0; from<numBatches && !failed; from+=batchesPerWindow) {
+    const int to = MIN(numBatches, from+batchesPerWindow);
+    #pragma omp parallel num_threads(nth)
+    {
+      int me = omp_get_thread_num();
+      int my_failed_compress = 0;
+      char *ch, *myBuff;
+      ch = myBuff = buffPool + me*buffSize;
+
+      void *myzBuff = NULL;
+      size_t myzbuffUsed = 0;
 #ifndef NOZLIB
-    z_stream *mystream = &thread_streams[me];
-    if (args.is_gzip) {
-      myzBuff = zbuffPool + me*zbuffSize;
-      if (init_stream(mystream)) { // this should be thread safe according to zlib documentation
-        failed = true;              // # nocov
-        my_failed_compress = -998;  // # nocov
+      z_stream *mystream = &thread_streams[me];
+      if (args.compress==FW_COMPRESS_GZIP) {
+        myzBuff = zbuffPool + me*zbuffSize;
+        if (init_stream(mystream, level)) { // this should be thread safe according to zlib documentation
+          failed = true;              // # nocov
+          my_failed_compress = -998;  // # nocov
+        }
+      }
+#endif
+#ifndef NOZSTD
+      ZSTD_CCtx *mycctx = NULL;  // reused for each batch so that its tables are allocated once per thread
+      if (args.compress==FW_COMPRESS_ZSTD) {
+        myzBuff = zbuffPool + me*zbuffSize;
+        if (!(mycctx = ZSTD_createCCtx())) {
+          failed = true;              // # nocov
+          my_failed_compress = -998;  // # nocov
+        }
       }
-    }
 #endif
 
-    #pragma omp for ordered schedule(dynamic)
-    for(int64_t start=0; start<args.nrow; start+=rowsPerBatch) {
-      if (failed) continue;  // Not break. Because we don't use #omp cancel yet.
-      int64_t end = ((args.nrow - start)<rowsPerBatch) ? args.nrow : start + rowsPerBatch;
-      for (int64_t i=start; i<end; i++) {
-        // Tepid starts here (once at beginning of each per line)
-        if (args.doRowNames) {
-          if (args.rowNames==NULL) {
-            if (doQuote!=0/*NA'auto' or true*/) *ch++='"';
-            int64_t rn = i+1;
-            writeInt64(&rn, 0, &ch);
-            if (doQuote!=0) *ch++='"';
-          } else {
-            writeString(args.rowNames, i, &ch);
+      #pragma omp for ordered schedule(dynamic)
+      for(int b=from; b<to; b++) {
+        if (failed) continue;  // Not break. Because we don't use #omp cancel yet.
+        const int64_t start = batchStart ? batchStart[b] : (int64_t)b*rowsPerBatch;
+        const int64_t end = batchStart ? batchStart[b+1] : MIN(args.nrow, start+rowsPerBatch);
+        for (int64_t i=start; i<end; i++) {
+          const int64_t row = args.rowIdx ? args.rowIdx[i]-1 : i;
+          // Tepid starts here (once at beginning of each per line)
+          if (args.doRowNames) {
+            if (args.rowNames==NULL) {
+              if (doQuote!=0/*NA'auto' or true*/) *ch++='"';
+              int64_t rn = row+1;
+              writeInt64(&rn, 0, &ch);
+              if (doQuote!=0) *ch++='"';
+            } else {
+              writeString(args.rowNames, row, &ch);
+            }
+            *ch++=sep;
           }
-          *ch++=sep;
-        }
-        // Hot loop
-        for (int j=0; j<args.ncol; j++) {
-          (args.funs[args.whichFun[j]])(args.columns[j], i, &ch);
-          *ch++ = sep;
+          // Hot loop
+          for (int j=0; j<args.ncol; j++) {
+            (args.funs[args.whichFun[j]])(args.columns[j], row, &ch);
+            *ch++ = sep;
+          }
+          // Tepid again (once at the end of each line)
+          ch--;  // backup onto the last sep after the last column. ncol>=1 because 0-columns was caught earlier.
+          write_chars(args.eol, &ch);  // overwrite last sep with eol instead
         }
-        // Tepid again (once at the end of each line)
-        ch--;  // backup onto the last sep after the last column. ncol>=1 because 0-columns was caught earlier.
-        write_chars(args.eol, &ch);  // overwrite last sep with eol instead
-      }
-      // compress buffer if gzip
+        // compress buffer if gzip or zstd
 #ifndef NOZLIB
-      if (args.is_gzip && !failed) {
-        myzbuffUsed = zbuffSize;
-        int ret = compressbuff(mystream, myzBuff, &myzbuffUsed, myBuff, (size_t)(ch-myBuff));
-        if (ret) { failed=true; my_failed_compress=ret; }
-        else deflateReset(mystream);
-      }
+        if (args.compress==FW_COMPRESS_GZIP && !failed) {
+          myzbuffUsed = zbuffSize;
+          int ret = compressbuff(mystream, myzBuff, &myzbuffUsed, myBuff, (size_t)(ch-myBuff));
+          if (ret) { failed=true; my_failed_compress=ret; }
+          else deflateReset(mystream);
+        }
 #endif
-      #pragma omp ordered
-      {
-        if (failed) {
-          // # nocov start
-          if (failed_compress==0 && my_failed_compress!=0) {
-            failed_compress = my_failed_compress;
-#ifndef NOZLIB
-            if (mystream->msg!=NULL) strncpy(failed_msg, mystream->msg, 1000); // copy zlib's msg for safe use after deflateEnd just in case zlib allocated the message
+#ifndef NOZSTD
+        if (args.compress==FW_COMPRESS_ZSTD && !failed) {
+          myzbuffUsed = ZSTD_compressCCtx(mycctx, myzBuff, zbuffSize, myBuff, (size_t)(ch-myBuff), level);
+          if (ZSTD_isError(myzbuffUsed)) { failed=true; my_failed_compress=-1; }
+        }
 #endif
-          }
-          // else another thread could have failed below while I was working or waiting above; their reason got here first
-          // # nocov end
-        } else {
-          errno=0;
-          if (f==-1) {
-            *ch='\0';  // standard C string end marker so DTPRINT knows where to stop
-            DTPRINT(myBuff);
-          } else if ((args.is_gzip ? WRITE(f, myzBuff, (int)myzbuffUsed)
-                                   : WRITE(f, myBuff,  (int)(ch-myBuff))) == -1) {
-            failed=true;         // # nocov
-            failed_write=errno;  // # nocov
-          }
-
-          int used = 100*((double)(ch-myBuff))/buffSize;  // percentage of original buffMB
-          if (used > maxBuffUsedPC) maxBuffUsedPC = used;
-          double now;
-          if (me==0 && args.showProgress && (now=wallclock())>=nextTime && !failed) {
-            // See comments above inside the f==-1 clause.
-            // Not only is this ordered section one-at-a-time but we'll also Rprintf() here only from the
-            // master thread (me==0) and hopefully this will work on Windows. If not, user should set
-            // showProgress=FALSE until this can be fixed or removed.
+        #pragma omp ordered
+        {
+          if (failed) {
             // # nocov start
-            int ETA = (int)((args.nrow-end)*((now-startTime)/end));
-            if (hasPrinted || ETA >= 2) {
-              if (verbose && !hasPrinted) DTPRINT("\n");
-              DTPRINT("\rWritten %.1f%% of %"PRId64" rows in %d secs using %d thread%s. "
-                      "maxBuffUsed=%d%%. ETA %d secs.      ",
-                       (100.0*end)/args.nrow, args.nrow, (int)(now-startTime), nth, nth==1?"":"s",
-                       maxBuffUsedPC, ETA);
-              // TODO: use progress() as in fread
-              nextTime = now+1;
-              hasPrinted = true;
+            if (failed_compress==0 && my_failed_compress!=0) {
+              failed_compress = my_failed_compress;
+#ifndef NOZLIB
+              if (args.compress==FW_COMPRESS_GZIP && mystream->msg!=NULL) strncpy(failed_msg, mystream->msg, 1000); // copy zlib's msg for safe use after deflateEnd just in case zlib allocated the message
+#endif
+#ifndef NOZSTD
+              if (args.compress==FW_COMPRESS_ZSTD && my_failed_compress==-1) strncpy(failed_msg, ZSTD_getErrorName(myzbuffUsed), 1000);
+#endif
             }
+            // else another thread could have failed below while I was working or waiting above; their reason got here first
             // # nocov end
+          } else {
+            errno=0;
+            if (batchPart && (b==0 || batchPart[b]!=batchPart[b-1])) {
+              // the first batch of a partition: start its file with the header
+              failed_file = args.partFiles[batchPart[b]];
+              if ((f=openOut(failed_file, false))==-1 || writeOut(f, header, headerBytes)==-1) {
+                failed=true;
+                failed_write=errno;
+              }
+              nFrames = headerFrame[1]>0;
+            }
+            if (failed) {
+              // the partition's file could not be opened or its header written
+            } else if (f==-1) {
+              *ch='\0';  // standard C string end marker so DTPRINT knows where to stop
+              DTPRINT(myBuff);
+            } else if ((args.compress!=FW_COMPRESS_NONE ? writeOut(f, myzBuff, myzbuffUsed)
+                                                        : writeOut(f, myBuff, (size_t)(ch-myBuff))) == -1) {
+              failed=true;         // # nocov
+              failed_write=errno;  // # nocov
+            } else if (frameSizes) {
+              frameSizes[2*nFrames] = (uint32_t)myzbuffUsed;
+              frameSizes[2*nFrames+1] = (uint32_t)(ch-myBuff);
+              nFrames++;
+            }
+            if (batchPart && !failed && (b==numBatches-1 || batchPart[b+1]!=batchPart[b])) {
+              // the last batch of a partition: end its file
+#ifndef NOZSTD
+              if (frameSizes && write_seek_table(f, frameSizes, nFrames)==-1) {
+                failed=true;         // # nocov
+                failed_write=errno;  // # nocov
+              }
+#endif
+              if (!failed && CLOSE(f)) {
+                failed=true;         // # nocov
+                failed_write=errno;  // # nocov
+              }
+              if (!failed) f=-3;
+            }
+            if (args.rowsDone && !failed) *args.rowsDone = end;
+
+            int used = 100*((double)(ch-myBuff))/buffSize;  // percentage of original buffMB
+            if (used > maxBuffUsedPC) maxBuffUsedPC = used;
+            double now;
+            if (me==0 && args.showProgress && (now=wallclock())>=nextTime && !failed) {
+              // See comments above inside the f==-1 clause.
+              // Not only is this ordered section one-at-a-time but we'll also Rprintf() here only from the
+              // master thread (me==0) and hopefully this will work on Windows. If not, user should set
+              // showProgress=FALSE until this can be fixed or removed.
+              // # nocov start
+              int ETA = (int)((args.nrow-end)*((now-startTime)/end));
+              if (hasPrinted || ETA >= 2) {
+                if (verbose && !hasPrinted) DTPRINT("\n");
+                DTPRINT("\rWritten %.1f%% of %"PRId64" rows in %d secs using %d thread%s. "
+                        "maxBuffUsed=%d%%. ETA %d secs.      ",
+                         (100.0*end)/args.nrow, args.nrow, (int)(now-startTime), nth, nth==1?"":"s",
+                         maxBuffUsedPC, ETA);
+                // TODO: use progress() as in fread
+                nextTime = now+1;
+                hasPrinted = true;
+              }
+              // # nocov end
+            }
+            // May be possible for master thread (me==0) to call R_CheckUserInterrupt() here.
+            // Something like:
+            // if (me==0) {
+            //   failed = TRUE;  // inside ordered here; the slaves are before ordered and not looking at 'failed'
+            //   R_CheckUserInterrupt();
+            //   failed = FALSE; // no user interrupt so return state
+            // }
+            // But I fear the slaves will hang waiting for the master (me==0) to complete the ordered
+            // section which may not happen if the master thread has been interrupted. Rather than
+            // seeing failed=TRUE and falling through to free() and close() as intended.
+            // Could register a finalizer to free() and close() perhaps :
+            // [r-devel] http://r.789695.n4.nabble.com/checking-user-interrupts-in-C-code-tp2717528p2717722.html
+            // Conclusion for now: do not provide ability to interrupt.
+            // write() errors and malloc() fails will be caught and cleaned up properly, however.
+            ch = myBuff;  // back to the start of my buffer ready to fill it up again
           }
-          // May be possible for master thread (me==0) to call R_CheckUserInterrupt() here.
-          // Something like:
-          // if (me==0) {
-          //   failed = TRUE;  // inside ordered here; the slaves are before ordered and not looking at 'failed'
-          //   R_CheckUserInterrupt();
-          //   failed = FALSE; // no user interrupt so return state
-          // }
-          // But I fear the slaves will hang waiting for the master (me==0) to complete the ordered
-          // section which may not happen if the master thread has been interrupted. Rather than
-          // seeing failed=TRUE and falling through to free() and close() as intended.
-          // Could register a finalizer to free() and close() perhaps :
-          // [r-devel] http://r.789695.n4.nabble.com/checking-user-interrupts-in-C-code-tp2717528p2717722.html
-          // Conclusion for now: do not provide ability to interrupt.
-          // write() errors and malloc() fails will be caught and cleaned up properly, however.
-          ch = myBuff;  // back to the start of my buffer ready to fill it up again
         }
       }
-    }
-    // all threads will call this free on their buffer, even if one or more threads had malloc
-    // or realloc fail. If the initial malloc failed, free(NULL) is ok and does nothing.
-    if (args.is_gzip) {
+      // all threads will call this free on their buffer, even if one or more threads had malloc
+      // or realloc fail. If the initial malloc failed, free(NULL) is ok and does nothing.
+      if (args.compress==FW_COMPRESS_GZIP) {
 #ifndef NOZLIB
-      deflateEnd(mystream);
+        deflateEnd(mystream);
+#endif
+      }
+#ifndef NOZSTD
+      ZSTD_freeCCtx(mycctx);  // NULL is ok
 #endif
     }
+    if (mem && mem->flush && !failed && mem->flush(mem)) failed = failed_flush = true;
   }
   free(buffPool);
   free(zbuffPool);
+  free(batchStart);
+  free(batchPart);
+  free(header);
+#ifndef NOZSTD
+  if (frameSizes && !failed && !args.nPart && write_seek_table(f, frameSizes, nFrames)==-1) {
+    failed=true;         // # nocov
+    failed_write=errno;  // # nocov
+  }
+#endif
+  free(frameSizes);
+  if (mem && mem->flush && !failed && mem->len && mem->flush(mem)) failed = failed_flush = true;  // the seek table
 
   // Finished parallel region and can call R API safely now.
   if (hasPrinted) {
@@ -983,14 +1218,25 @@ void fwriteMain(fwriteMainArgs args)
     // # nocov end
   }
 
-  if (f!=-1 && CLOSE(f) && !failed)
+  if (f>=0 && CLOSE(f) && !failed)
     STOP("%s: '%s'", strerror(errno), args.filename);  // # nocov
   // quoted '%s' in case of trailing spaces in the filename
   // If a write failed, the line above tries close() to clean up, but that might fail as well. So the
   // '&& !failed' is to not report the error as just 'closing file' but the next line for more detail
   // from the original error.
   if (failed) {
+    if (failed_flush) {
+      if (mem->msg[0]) STOP(_("Failed to write to %s: %s"), args.filename, mem->msg);
+      STOP(_("Failed to write to %s"), args.filename);  // # nocov
+    }
     // # nocov start
+#ifndef NOZSTD
+    if (failed_compress && args.compress==FW_COMPRESS_ZSTD)
+      STOP(_("zstd %s (zstd.h %s) compression returned error \"%s\". %s"),
+           ZSTD_versionString(), ZSTD_VERSION_STRING, failed_msg,
+           verbose ? _("Please include the full output above and below this message in your data.table bug report.")
+                   : _("Please retry fwrite() with verbose=TRUE and include the full output with your data.table bug report."));
+#endif
 #ifndef NOZLIB
     if (failed_compress)
       STOP(_("zlib %s (zlib.h %s) deflate() returned error %d with z_stream->msg==\"%s\" Z_FINISH=%d Z_BLOCK=%d. %s"),
@@ -999,7 +1245,7 @@ void fwriteMain(fwriteMainArgs args)
                    : _("Please retry fwrite() with verbose=TRUE and include the full output with your data.table bug report."));
 #endif
     if (failed_write)
-      STOP("%s: '%s'", strerror(failed_write), args.filename);
+      STOP("%s: '%s'", strerror(failed_write), failed_file);
     // # nocov end
   }
 }
@@ -4,8 +4,9 @@
   #define STRICT_R_HEADERS
   #include <R.h>
   #include "po.h"
-  #define STOP     error
+  #define STOP     fwriteError  // error(), except on the background thread of fwrite(async=TRUE); see fwriteR.c
   #define DTPRINT  Rprintf
+  void fwriteError(const char *format, ...);
 #endif
 
 typedef void (*writer_fun_t)(const void *, int64_t, char **);
@@ -65,12 +66,31 @@ static const int writerMaxLen[] = {  // same order as fun[] and WFs above; max f
   0,  //&writeList
 };
 
+typedef enum {
+  FW_COMPRESS_NONE,
+  FW_COMPRESS_GZIP,  // concatenated gzip members, one per batch
+  FW_COMPRESS_ZSTD   // zstd frames, one per batch, followed by a seek table in the zstd seekable format
+} FWcompress;
+
+typedef struct fwriteBuffer {
+  // Output to memory rather than to a file: each batch is appended to data in the ordered section, where it would be
+  // written to the file. When flush is not NULL, it is called on the calling thread between windows of batches, and
+  // after the last, to pass on and then empty data; so data stays small. A nonzero return from flush stops fwrite, with
+  // msg in the error when flush has set it.
+  char *data;
+  size_t len;
+  size_t cap;
+  int (*flush)(struct fwriteBuffer *);
+  char msg[1000];
+} fwriteBuffer;
+
 typedef struct fwriteMainArgs
 {
   // Name of the file to open (a \0-terminated C string). If the file name
   // contains non-ASCII characters, it should be UTF-8 encoded (however fread
   // will not validate the encoding).
   const char *filename;
+  fwriteBuffer *buffer;   // not NULL means write to this rather than to filename, which then just names it in messages
   int ncol;
   int64_t nrow;
   // a vector of pointers to all-same-length column vectors
@@ -106,10 +126,21 @@ typedef struct fwriteMainArgs
   int buffMB;             // [1-1024] default 8MB
   int nth;
   bool showProgress;
-  bool is_gzip;
+  int8_t compress;        // FW_COMPRESS_NONE, FW_COMPRESS_GZIP or FW_COMPRESS_ZSTD; each batch is compressed by its thread
+  int compressLevel;      // INT_MIN (NA_INTEGER at R level) means the default level of the codec
   bool bom;
   const char *yaml;
   bool verbose;
+  volatile int64_t *rowsDone;  // not NULL: set to the number of rows written so far, to poll fwrite(async=TRUE)
+
+  // Partitioned output (fwrite(partition_by=)): nPart>0 means output row i is row rowIdx[i]-1 of the columns (1-based as
+  // returned by forder) and rows [partStart[p], partStart[p+1]) of the output go to file partFiles[p], each with its own
+  // header. filename then just names the directory in messages. Batches never span two partitions so all partitions are
+  // formatted in the one parallel pass while each file is written in turn by the ordered section.
+  int nPart;
+  const int *rowIdx;
+  const int64_t *partStart;   // nPart+1 with partStart[nPart]==nrow
+  const char **partFiles;
 } fwriteMainArgs;
 
 void fwriteMain(fwriteMainArgs args);
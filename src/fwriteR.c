@@ -1,6 +1,11 @@
 #include <stdbool.h>
+#include <stdarg.h>
 #include "data.table.h"
 #include "fwrite.h"
+#ifndef WIN32
+#include <pthread.h>
+#include <setjmp.h>
+#endif
 
 #define DATETIMEAS_EPOCH     2
 #define DATETIMEAS_WRITECSV  3
@@ -43,7 +48,7 @@ int getMaxStringLen(const SEXP *col, const int64_t n) {
 
 int getMaxCategLen(SEXP col) {
   col = getAttrib(col, R_LevelsSymbol);
-  if (!isString(col)) error(_("Internal error: col passed to getMaxCategLen is missing levels"));
+  if (!isString(col)) STOP(_("Internal error: col passed to getMaxCategLen is missing levels"));
   return getMaxStringLen( STRING_PTR(col), LENGTH(col) );
 }
 
@@ -100,7 +105,7 @@ int getMaxListItemLen(const SEXP *col, const int64_t n) {
     if (this==last) continue; // no point calling LENGTH() again on the same string; LENGTH is unlikely as fast as single pointer compare
     int32_t wf = whichWriter(this);
     if (TYPEOF(this)==VECSXP || wf==INT32_MIN || isFactor(this)) {
-      error(_("Row %"PRId64" of list column is type '%s' - not yet implemented. fwrite() can write list columns containing items which are atomic vectors of type logical, integer, integer64, double, complex and character."),
+      STOP(_("Row %"PRId64" of list column is type '%s' - not yet implemented. fwrite() can write list columns containing items which are atomic vectors of type logical, integer, integer64, double, complex and character."),
             i+1, isFactor(this) ? "factor" : type2char(TYPEOF(this)));
     }
     int width = writerMaxLen[wf];
@@ -147,6 +152,131 @@ static int32_t whichWriter(SEXP column) {
   }
 }
 
+static fwriteBuffer buffer = {0};  // static so that the memory left by an error inside fwriteMain is freed by the next call
+static SEXP sink;                   // the R function which is passed each chunk of output written to buffer
+
+static int flushToSink(fwriteBuffer *b) {
+  // called by fwriteMain on this thread between its parallel regions. sink is wrapped at R level to return the message
+  // of an error rather than raise it, so that fwriteMain can include it in its own error after cleaning up
+  SEXP chunk = PROTECT(allocVector(RAWSXP, b->len));
+  memcpy(RAW(chunk), b->data, b->len);
+  b->len = 0;
+  SEXP call = PROTECT(lang2(sink, chunk));
+  int err = 0;
+  SEXP ans = R_tryEval(call, R_GlobalEnv, &err);
+  if (!err && isString(ans) && LENGTH(ans)==1) {
+    snprintf(b->msg, sizeof(b->msg), "%s", CHAR(STRING_ELT(ans, 0)));
+    err = 1;
+  }
+  UNPROTECT(2);
+  return err;
+}
+
+// fwrite(async=TRUE) runs fwriteMain on a background thread and returns a handle at once. The globals in this file and
+// in fwrite.c hold the arguments, so one fwrite runs at a time: the next fwrite waits for the background one to finish
+// first. fwriteMain must not call R's API there, so verbose and showProgress are off, encoding is not translated, and
+// STOP (fwriteError) longjmps back to asyncMain with its message, which fwriteWait() raises.
+typedef struct {
+  fwriteMainArgs args;
+  SEXP keep;                  // the columns being written, and the vectors args points into
+  volatile int64_t rowsDone;
+  volatile bool done;
+  bool failed;
+  char msg[2000];
+#ifndef WIN32
+  pthread_t thread;
+  jmp_buf jmp;
+#endif
+} AsyncJob;
+
+static AsyncJob *running = NULL;  // not yet joined
+static AsyncJob *bgJob = NULL;    // set on the background thread while it runs fwriteMain
+
+void fwriteError(const char *format, ...) {
+  char msg[2000];
+  va_list ap;
+  va_start(ap, format);
+  vsnprintf(msg, sizeof(msg), format, ap);
+  va_end(ap);
+#ifndef WIN32
+  if (bgJob) {
+    strcpy(bgJob->msg, msg);
+    longjmp(bgJob->jmp, 1);
+  }
+#endif
+  error("%s", msg);
+}
+
+#ifndef WIN32
+static void *asyncMain(void *p) {
+  AsyncJob *job = p;
+  bgJob = job;
+  if (setjmp(job->jmp)==0) fwriteMain(job->args);
+  else job->failed = true;
+  bgJob = NULL;
+  job->done = true;
+  return NULL;
+}
+#endif
+
+static void joinRunning() {
+  // the outcome stays in the job for fwriteWait()
+  if (!running) return;
+#ifndef WIN32
+  pthread_join(running->thread, NULL);
+#endif
+  running = NULL;
+}
+
+bool fwriteAsyncUses(SEXP col) {
+  // Whether col is being written by fwrite(async=TRUE). The columns are not copied up front, so every function which updates
+  // a column by reference checks this first: := and set (assign.c), := by group (dogroups.c), setkey and setorder (reorder.c)
+  // and setnafill (nafill.c) replace it in the table with a copy, so that the file has the data as it was when fwrite was
+  // called. setcoalesce (coalesce.c) updates a vector rather than a table's column, so it cannot swap in a copy and stops.
+  if (!running || running->done) return false;
+  const SEXP cols = VECTOR_ELT(running->keep, 0);
+  for (int j=0; j<length(cols); j++) if (VECTOR_ELT(cols, j)==col) return true;
+  return false;
+}
+
+static void finalizeJob(SEXP handle) {
+  AsyncJob *job = R_ExternalPtrAddr(handle);
+  if (!job) return;
+  if (job==running) joinRunning();  // including when R exits, so that the file is complete
+  free(job->args.columns);
+  free(job->args.whichFun);
+  free(job);
+  R_ClearExternalPtr(handle);
+}
+
+static AsyncJob *jobOf(SEXP handle) {
+  if (TYPEOF(handle)!=EXTPTRSXP || !INHERITS(handle, char_fwriteAsync) || !R_ExternalPtrAddr(handle))
+    error(_("Not a handle returned by fwrite(async=TRUE)"));
+  return R_ExternalPtrAddr(handle);
+}
+
+SEXP fwriteWaitR(SEXP handle) {
+  AsyncJob *job = jobOf(handle);
+  if (job==running) joinRunning();
+  if (job->failed) error("%s", job->msg);
+  return R_NilValue;
+}
+
+SEXP fwriteStatusR(SEXP handle) {
+  AsyncJob *job = jobOf(handle);
+  const bool done = job->done;  // before rowsDone so that the rows are final when done
+  SEXP ans = PROTECT(allocVector(VECSXP, 5));
+  SEXP nms = PROTECT(allocVector(STRSXP, 5));
+  SET_VECTOR_ELT(ans, 0, ScalarString(STRING_ELT(VECTOR_ELT(job->keep, 1), 0)));  SET_STRING_ELT(nms, 0, mkChar("file"));
+  SET_VECTOR_ELT(ans, 1, ScalarLogical(done));                                     SET_STRING_ELT(nms, 1, mkChar("done"));
+  SET_VECTOR_ELT(ans, 2, ScalarReal((double)job->rowsDone));                       SET_STRING_ELT(nms, 2, mkChar("rows"));
+  SET_VECTOR_ELT(ans, 3, ScalarReal((double)job->args.nrow));                      SET_STRING_ELT(nms, 3, mkChar("nrow"));
+  SET_VECTOR_ELT(ans, 4, ScalarString(done && job->failed ? mkChar(job->msg) : NA_STRING));  SET_STRING_ELT(nms, 4, mkChar("error"));
+  setAttrib(ans, R_NamesSymbol, nms);
+  UNPROTECT(2);
+  return ans;
+}
+
 SEXP fwriteR(
   SEXP DF,                 // any list of same length vectors; e.g. data.frame, data.table
   SEXP filename_Arg,
@@ -166,17 +296,23 @@ SEXP fwriteR(
   SEXP buffMB_Arg,         // [1-1024] default 8MB
   SEXP nThread_Arg,
   SEXP showProgress_Arg,
-  SEXP is_gzip_Arg,
+  SEXP compress_Arg,       // 0=none, 1=gzip, 2=zstd
+  SEXP compressLevel_Arg,  // NA for the default level of the codec
   SEXP bom_Arg,
   SEXP yaml_Arg,
   SEXP verbose_Arg,
-  SEXP encoding_Arg
+  SEXP encoding_Arg,
+  SEXP sink_Arg,           // NULL to write to filename, TRUE to return a raw vector, or a function to pass chunks of output to
+  SEXP async_Arg,          // TRUE|FALSE
+  SEXP partition_Arg       // NULL, or list(order, starts, files) to write rows order[starts[p]:(starts[p+1]-1)] to files[p]
   )
 {
   if (!isNewList(DF)) error(_("fwrite must be passed an object of type list; e.g. data.frame, data.table"));
+  joinRunning();
 
   fwriteMainArgs args = {0};  // {0} to quieten valgrind's uninitialized, #4639
-  args.is_gzip = LOGICAL(is_gzip_Arg)[0];
+  args.compress = (int8_t)INTEGER(compress_Arg)[0];
+  args.compressLevel = INTEGER(compressLevel_Arg)[0];  // NA_INTEGER is INT_MIN which fwriteMain takes as the default
   args.bom = LOGICAL(bom_Arg)[0];
   args.yaml = CHAR(STRING_ELT(yaml_Arg, 0));
   args.verbose = LOGICAL(verbose_Arg)[0];
@@ -293,8 +429,94 @@ SEXP fwriteR(
   args.nth = INTEGER(nThread_Arg)[0];
   args.showProgress = LOGICAL(showProgress_Arg)[0];
 
+  if (!isNull(partition_Arg)) {
+    // the order and group starts of the partition_by= columns from forder, computed once in fwrite.R
+    SEXP order = VECTOR_ELT(partition_Arg, 0), starts = VECTOR_ELT(partition_Arg, 1), files = VECTOR_ELT(partition_Arg, 2);
+    if (length(order) && length(order)!=args.nrow)
+      error(_("Internal error: the partition order is length %d but there are %"PRId64" rows"), length(order), args.nrow); // # nocov
+    args.nPart = length(files);
+    args.rowIdx = length(order) ? INTEGER(order) : NULL;  // integer() when already grouped
+    int64_t *partStart = (int64_t *)R_alloc(args.nPart+1, sizeof(int64_t));
+    const char **partFiles = (const char **)R_alloc(args.nPart, sizeof(const char *));
+    for (int p=0; p<args.nPart; p++) {
+      partStart[p] = INTEGER(starts)[p]-1;
+      partFiles[p] = CHAR(STRING_ELT(files, p));
+    }
+    partStart[args.nPart] = args.nrow;
+    args.partStart = partStart;
+    args.partFiles = partFiles;
+  }
+
+  if (LOGICAL(async_Arg)[0]) {
+#ifdef WIN32
+    error(_("fwrite(async=TRUE) is not yet available on Windows"));
+#else
+    // args points into these, which the handle keeps until it is garbage collected after the write has finished
+    SEXP keep = PROTECT(allocVector(VECSXP, 8)); protecti++;
+    SEXP cols = allocVector(VECSXP, args.ncol);
+    SET_VECTOR_ELT(keep, 0, cols);
+    for (int j=0; j<args.ncol; j++) SET_VECTOR_ELT(cols, j, VECTOR_ELT(DFcoerced, j));  // DF's columns may be replaced
+    SET_VECTOR_ELT(keep, 1, filename_Arg);
+    SET_VECTOR_ELT(keep, 2, eol_Arg);
+    SET_VECTOR_ELT(keep, 3, na_Arg);
+    SET_VECTOR_ELT(keep, 4, yaml_Arg);
+    SET_VECTOR_ELT(keep, 5, sep2_Arg);
+    if (args.colNames) {
+      SEXP cn2 = duplicate(cn);  // setnames() updates the names by reference
+      SET_VECTOR_ELT(keep, 6, cn2);
+      args.colNames = DATAPTR_RO(cn2);
+    }
+    if (args.rowNames) SET_VECTOR_ELT(keep, 7, getAttrib(DF, R_RowNamesSymbol));
+    AsyncJob *job = calloc(1, sizeof(AsyncJob));
+    const void **columns = malloc(args.ncol*sizeof(const void *));
+    uint8_t *whichFun = malloc(args.ncol);
+    if (!job || !columns || !whichFun) {
+      free(job); free(columns); free(whichFun);          // # nocov
+      error(_("Unable to allocate the fwrite(async=TRUE) job"));  // # nocov
+    }
+    memcpy(columns, args.columns, args.ncol*sizeof(const void *));
+    memcpy(whichFun, args.whichFun, args.ncol);
+    args.columns = columns;
+    args.whichFun = whichFun;
+    args.verbose = false;
+    args.showProgress = false;
+    args.rowsDone = &job->rowsDone;
+    job->args = args;
+    job->keep = keep;
+    SEXP ans = PROTECT(R_MakeExternalPtr(job, R_NilValue, keep)); protecti++;
+    R_RegisterCFinalizerEx(ans, finalizeJob, TRUE);
+    setAttrib(ans, R_ClassSymbol, ScalarString(char_fwriteAsync));
+    running = job;
+    int err = pthread_create(&job->thread, NULL, asyncMain, job);
+    if (err) {
+      running = NULL;                                                                      // # nocov
+      error(_("Unable to start the thread for fwrite(async=TRUE): %s"), strerror(err));  // # nocov
+    }
+    UNPROTECT(protecti);
+    return ans;
+#endif
+  }
+
+  if (!isNull(sink_Arg)) {
+    free(buffer.data);
+    buffer = (fwriteBuffer){0};
+    sink = sink_Arg;
+    if (isFunction(sink)) buffer.flush = flushToSink;
+    args.buffer = &buffer;
+  }
+
   fwriteMain(args);
 
+  SEXP ans = R_NilValue;
+  if (args.buffer) {
+    if (!buffer.flush) {
+      ans = PROTECT(allocVector(RAWSXP, buffer.len));
+      protecti++;
+      if (buffer.len) memcpy(RAW(ans), buffer.data, buffer.len);
+    }
+    free(buffer.data);
+    buffer = (fwriteBuffer){0};
+  }
   UNPROTECT(protecti);
-  return(R_NilValue);
+  return(ans);
 }
@@ -23,6 +23,7 @@ SEXP char_datatable;
 SEXP char_dataframe;
 SEXP char_NULL;
 SEXP char_maxString;
+SEXP char_fwriteAsync;
 SEXP sym_sorted;
 SEXP sym_index;
 SEXP sym_BY;
@@ -60,7 +61,10 @@ SEXP chin_R();
 SEXP fifelseR();
 SEXP fcaseR();
 SEXP freadR();
+SEXP freadAppendR();
 SEXP fwriteR();
+SEXP fwriteWaitR();
+SEXP fwriteStatusR();
 SEXP reorder();
 SEXP rbindlist();
 SEXP vecseq();
@@ -127,6 +131,11 @@ SEXP islockedR();
 SEXP allNAR();
 SEXP test_dt_win_snprintf();
 SEXP dt_zlib_version();
+SEXP dt_has_zlib();
+SEXP exportArrowR();
+SEXP arrowToListR();
+SEXP fsaveR();
+SEXP floadR();
 
 // .Externals
 SEXP fastmean();
@@ -148,7 +157,10 @@ R_CallMethodDef callMethods[] = {
 {"Cchmatchdup", (DL_FUNC) &chmatchdup_R, -1},
 {"Cchin", (DL_FUNC) &chin_R, -1},
 {"CfreadR", (DL_FUNC) &freadR, -1},
+{"CfreadAppendR", (DL_FUNC) &freadAppendR, -1},
 {"CfwriteR", (DL_FUNC) &fwriteR, -1},
+{"CfwriteWaitR", (DL_FUNC) &fwriteWaitR, -1},
+{"CfwriteStatusR", (DL_FUNC) &fwriteStatusR, -1},
 {"Creorder", (DL_FUNC) &reorder, -1},
 {"Crbindlist", (DL_FUNC) &rbindlist, -1},
 {"Cvecseq", (DL_FUNC) &vecseq, -1},
@@ -221,7 +233,12 @@ R_CallMethodDef callMethods[] = {
 {"CcoerceAs", (DL_FUNC) &coerceAs, -1},
 {"Ctest_dt_win_snprintf", (DL_FUNC)&test_dt_win_snprintf, -1},
 {"Cdt_zlib_version", (DL_FUNC)&dt_zlib_version, -1},
+{"Cdt_has_zlib", (DL_FUNC)&dt_has_zlib, -1},
 {"Csubstitute_call_arg_namesR", (DL_FUNC) &substitute_call_arg_namesR, -1},
+{"CexportArrowR", (DL_FUNC) &exportArrowR, -1},
+{"CarrowToListR", (DL_FUNC) &arrowToListR, -1},
+{"CfsaveR", (DL_FUNC) &fsaveR, -1},
+{"CfloadR", (DL_FUNC) &floadR, -1},
 {NULL, NULL, 0}
 };
 
@@ -339,6 +356,7 @@ void attribute_visible R_init_datatable(DllInfo *info)
   char_dataframe = PRINTNAME(install("data.frame"));
   char_NULL =      PRINTNAME(install("NULL"));
   char_maxString = PRINTNAME(install("\xFF\xFF\xFF\xFF\xFF\xFF\xFF\xFF"));
+  char_fwriteAsync = PRINTNAME(install("fwriteAsync"));
 
   if (TYPEOF(char_integer64) != CHARSXP) {
     // checking one is enough in case of any R-devel changes
@@ -121,6 +121,8 @@ SEXP nafillR(SEXP obj, SEXP type, SEXP fill, SEXP nan_is_na_arg, SEXP inplace, S
     SEXP this_col = VECTOR_ELT(obj, icols[i]-1);
     if (!isReal(this_col) && !isInteger(this_col))
       error(_("'x' argument must be numeric type, or list/data.table of numeric types"));
+    if (binplace && fwriteAsyncUses(this_col))
+      SET_VECTOR_ELT(obj, icols[i]-1, this_col=copyAsPlain(this_col));
     SET_VECTOR_ELT(x, i, this_col);
   }
   R_len_t nx = length(x);
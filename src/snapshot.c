@@ -0,0 +1,275 @@
+#include "data.table.h"
+#include <errno.h>
+#ifdef WIN32
+  #define FSEEK _fseeki64
+  #define FTELL _ftelli64
+#else
+  #define FSEEK fseeko
+  #define FTELL ftello
+#endif
+
+// Binary snapshot of a data.table's columns, written by fsave() and read by fload(); see ?fsave.
+// The file is
+//   "DTSNAP\1\0"                                      8 byte magic
+//   one block per column, each starting at a multiple of 64 bytes
+//   directory                                         ncol * DirEntry
+//   meta                                              serialize()d by R: names, attributes and so on
+//   footer                                            Footer
+// written in the byte order of the machine; fload() checks the order and refuses a file written on the other kind.
+// Logical, integer, double, complex and raw columns are their R data as is, so are read straight into the new vector
+// with no parsing. A character column is its dictionary: an int32 code for each row (NA_INTEGER for NA) followed by the
+// uint64 offsets (nuniq+1) of the distinct strings in the chars, one uint8 cetype_t for each string, then the chars.
+// Each distinct string is then created once by fload(), rather than once for each row.
+
+static const char magic[8] = "DTSNAP\1";  // the terminating nul is the 8th byte
+
+typedef struct {
+  int32_t type;     // SEXPTYPE
+  int32_t nuniq;    // character columns: the number of distinct strings
+  int64_t length;
+  uint64_t offset;
+  uint64_t nbytes;
+} DirEntry;
+
+typedef struct {
+  uint64_t dirOffset;
+  uint64_t metaOffset;
+  uint64_t metaLen;
+  int64_t nrow;
+  int32_t ncol;
+  uint32_t order;   // 0x01020304 as written, to detect the byte order
+  char magic[8];
+} Footer;
+
+#define ALIGN 64
+
+static bool writeBytes(FILE *f, const void *p, size_t n, uint64_t *pos) {
+  *pos += n;
+  return n==0 || fwrite(p, 1, n, f)==n;
+}
+
+static bool pad(FILE *f, uint64_t *pos) {
+  static const char zeros[ALIGN] = {0};
+  return writeBytes(f, zeros, (ALIGN - *pos%ALIGN) % ALIGN, pos);
+}
+
+static bool writeStrings(FILE *f, SEXP col, DirEntry *d, uint64_t *pos) {
+  // Codes the strings by their CHARSXP so that the dictionary is built in one pass; R's global cache means equal
+  // strings in the same encoding are the same CHARSXP. Their truelength is the code while this runs, as in chmatch.c.
+  const R_xlen_t n = xlength(col);
+  const SEXP *xd = STRING_PTR(col);
+  int32_t *codes = malloc(n*sizeof(int32_t) + 1);
+  SEXP *uniq = malloc(n*sizeof(SEXP) + 1);
+  if (!codes || !uniq) {
+    free(codes); free(uniq);                                                                         // # nocov
+    error(_("Unable to allocate %"PRIu64" bytes of working memory to save a character column"), (uint64_t)n*(sizeof(int32_t)+sizeof(SEXP)));  // # nocov
+  }
+  savetl_init();
+  int nuniq = 0;
+  for (R_xlen_t i=0; i<n; i++) {
+    SEXP s = xd[i];
+    if (s==NA_STRING) { codes[i]=NA_INTEGER; continue; }
+    int tl = TRUELENGTH(s);
+    if (tl>0) { savetl(s); tl=0; }  // R's internal hash (which is positive); save it
+    if (tl==0) { uniq[nuniq]=s; SET_TRUELENGTH(s, -(++nuniq)); tl=-nuniq; }
+    codes[i] = -tl-1;
+  }
+  for (int i=0; i<nuniq; i++) SET_TRUELENGTH(uniq[i], 0);
+  savetl_end();
+
+  uint64_t *offsets = malloc((nuniq+1)*sizeof(uint64_t));
+  uint8_t *enc = malloc(nuniq+1);
+  bool ok = offsets && enc;
+  if (ok) {
+    offsets[0] = 0;
+    for (int i=0; i<nuniq; i++) {
+      offsets[i+1] = offsets[i] + LENGTH(uniq[i]);
+      enc[i] = (uint8_t)getCharCE(uniq[i]);
+    }
+    d->nuniq = nuniq;
+    ok = writeBytes(f, codes, n*sizeof(int32_t), pos) &&
+         writeBytes(f, offsets, (nuniq+1)*sizeof(uint64_t), pos) &&
+         writeBytes(f, enc, nuniq, pos);
+    for (int i=0; ok && i<nuniq; i++) ok = writeBytes(f, CHAR(uniq[i]), LENGTH(uniq[i]), pos);
+  }
+  free(codes); free(uniq); free(offsets); free(enc);
+  return ok;
+}
+
+SEXP fsaveR(SEXP cols, SEXP fileArg, SEXP metaArg, SEXP verboseArg) {
+  if (!isNewList(cols))
+    error(_("Internal error: fsaveR() was passed a '%s' rather than a list of columns"), type2char(TYPEOF(cols)));  // # nocov
+  if (!isString(fileArg) || length(fileArg)!=1 || STRING_ELT(fileArg,0)==NA_STRING)
+    error(_("'file' must be a single character string"));
+  if (TYPEOF(metaArg)!=RAWSXP)
+    error(_("Internal error: fsaveR() was passed meta of type '%s' rather than raw"), type2char(TYPEOF(metaArg)));  // # nocov
+  const bool verbose = LOGICAL(verboseArg)[0]==1;
+  const int ncol = length(cols);
+  for (int j=0; j<ncol; j++) {
+    switch(TYPEOF(VECTOR_ELT(cols,j))) {
+    case LGLSXP: case INTSXP: case REALSXP: case CPLXSXP: case RAWSXP: break;
+    case STRSXP:
+      // the dictionary codes and the number of distinct strings are int32
+      if (xlength(VECTOR_ELT(cols,j))>INT_MAX)
+        error(_("Column %d is a character column of %"PRId64" rows; fsave() can save at most %d rows of character columns"), j+1, (int64_t)xlength(VECTOR_ELT(cols,j)), INT_MAX);
+      break;
+    default:
+      error(_("Column %d is type '%s' which fsave() cannot save"), j+1, type2char(TYPEOF(VECTOR_ELT(cols,j))));
+    }
+  }
+  const char *fnam = R_ExpandFileName(translateChar(STRING_ELT(fileArg,0)));
+  DirEntry *dir = calloc(ncol+1, sizeof(DirEntry));
+  if (!dir) error(_("Unable to allocate the directory of %d columns"), ncol);  // # nocov
+  FILE *f = fopen(fnam, "wb");
+  if (!f) {
+    free(dir);
+    error(_("Unable to create file '%s' for writing: %s"), fnam, strerror(errno));
+  }
+  double tt0 = wallclock();
+  uint64_t pos = 0;
+  bool ok = writeBytes(f, magic, sizeof(magic), &pos);
+  for (int j=0; ok && j<ncol; j++) {
+    SEXP col = VECTOR_ELT(cols, j);
+    ok = pad(f, &pos);
+    DirEntry *d = dir+j;
+    d->type = TYPEOF(col);
+    d->length = xlength(col);
+    d->offset = pos;
+    if (isString(col)) ok = ok && writeStrings(f, col, d, &pos);
+    else ok = ok && writeBytes(f, DATAPTR_RO(col), (size_t)d->length*SIZEOF(col), &pos);
+    d->nbytes = pos - d->offset;
+    if (verbose) {
+      if (isString(col)) Rprintf(_("Column %d of type '%s' saved in %"PRIu64" bytes with %d distinct strings\n"), j+1, type2char(d->type), d->nbytes, d->nuniq);
+      else Rprintf(_("Column %d of type '%s' saved in %"PRIu64" bytes\n"), j+1, type2char(d->type), d->nbytes);
+    }
+  }
+  Footer foot = { .ncol=ncol, .order=0x01020304, .nrow = ncol ? dir[0].length : 0 };
+  memcpy(foot.magic, magic, sizeof(magic));
+  ok = ok && pad(f, &pos);
+  foot.dirOffset = pos;
+  ok = ok && writeBytes(f, dir, ncol*sizeof(DirEntry), &pos);
+  foot.metaOffset = pos;
+  foot.metaLen = LENGTH(metaArg);
+  ok = ok && writeBytes(f, RAW(metaArg), foot.metaLen, &pos) && writeBytes(f, &foot, sizeof(Footer), &pos);
+  free(dir);
+  int err = errno;
+  if (fclose(f)) { ok=false; err=errno; }
+  if (!ok) error(_("Failed to write to file '%s': %s"), fnam, strerror(err));
+  if (verbose) Rprintf(_("Saved %d columns in %"PRIu64" bytes in %.3fs\n"), ncol, pos, wallclock()-tt0);
+  return R_NilValue;
+}
+
+static FILE *rf = NULL;
+static const char *rfnam = NULL;
+
+static void readFail(const char *msg) {
+  // closes the file before error() as R longjmps out
+  if (rf) { fclose(rf); rf=NULL; }
+  error(_("File '%s' is not a snapshot written by fsave(), or it is damaged: %s"), rfnam, msg);
+}
+
+static void readAt(void *dest, uint64_t offset, uint64_t n) {
+  if (n==0) return;
+  if (FSEEK(rf, offset, SEEK_SET) || fread(dest, 1, n, rf)!=n) readFail(_("it is shorter than its directory says"));
+}
+
+SEXP floadR(SEXP fileArg, SEXP selectArg, SEXP verboseArg) {
+  // Returns list(columns, meta) where meta is the raw vector which fsave() passed to fsaveR(). When select is
+  // NULL, all the columns are read; else just those columns, so select=integer() returns only the meta.
+  if (!isString(fileArg) || length(fileArg)!=1 || STRING_ELT(fileArg,0)==NA_STRING)
+    error(_("'file' must be a single character string"));
+  if (!isNull(selectArg) && !isInteger(selectArg))
+    error(_("Internal error: floadR() was passed select of type '%s' rather than integer"), type2char(TYPEOF(selectArg)));  // # nocov
+  const bool verbose = LOGICAL(verboseArg)[0]==1;
+  rfnam = R_ExpandFileName(translateChar(STRING_ELT(fileArg,0)));
+  rf = fopen(rfnam, "rb");
+  if (!rf) error(_("Unable to open file '%s': %s"), rfnam, strerror(errno));
+  double tt0 = wallclock();
+  Footer foot;
+  char head[sizeof(magic)];
+  if (FSEEK(rf, 0, SEEK_END)) readFail(_("unable to seek to its end"));  // # nocov
+  const int64_t fileSize = (int64_t)FTELL(rf);
+  if (fileSize < (int64_t)(sizeof(magic)+sizeof(Footer))) readFail(_("it is too short"));
+  readAt(head, 0, sizeof(head));
+  readAt(&foot, fileSize-sizeof(Footer), sizeof(Footer));
+  if (memcmp(head, magic, sizeof(magic)) || memcmp(foot.magic, magic, sizeof(magic))) readFail(_("its magic bytes are wrong"));
+  if (foot.order!=0x01020304) readFail(_("it was written on a machine with the other byte order"));
+  if (foot.ncol<0 || foot.dirOffset+(uint64_t)foot.ncol*sizeof(DirEntry) > foot.metaOffset ||
+      foot.metaOffset+foot.metaLen+sizeof(Footer) != (uint64_t)fileSize) readFail(_("its footer is inconsistent"));
+  const int ncol = foot.ncol;
+  int nselect = ncol;
+  const int *sel = NULL;
+  if (!isNull(selectArg)) {
+    nselect = length(selectArg);
+    sel = INTEGER(selectArg);
+    for (int i=0; i<nselect; i++) if (sel[i]<1 || sel[i]>ncol) {
+      fclose(rf); rf=NULL;
+      error(_("select[%d]=%d is outside the %d columns in the file"), i+1, sel[i], ncol);
+    }
+  }
+  DirEntry *dir = (DirEntry *)R_alloc(ncol+1, sizeof(DirEntry));
+  readAt(dir, foot.dirOffset, ncol*sizeof(DirEntry));
+  SEXP ans = PROTECT(allocVector(VECSXP, 2));
+  SEXP cols = allocVector(VECSXP, nselect);
+  SET_VECTOR_ELT(ans, 0, cols);
+  SEXP meta = allocVector(RAWSXP, foot.metaLen);
+  SET_VECTOR_ELT(ans, 1, meta);
+  readAt(RAW(meta), foot.metaOffset, foot.metaLen);
+  for (int i=0; i<nselect; i++) {
+    const int j = sel ? sel[i]-1 : i;
+    const DirEntry *d = dir+j;
+    // every row takes at least one byte, so length<=nbytes; checked before the products below and any allocation
+    if (d->length<0 || (uint64_t)d->length > d->nbytes || d->nbytes > foot.dirOffset || d->offset > foot.dirOffset-d->nbytes)
+      readFail(_("its directory is inconsistent"));
+    switch(d->type) {
+    case LGLSXP: case INTSXP: case REALSXP: case CPLXSXP: case RAWSXP: {
+      const size_t width = d->type==RAWSXP ? 1 : d->type==CPLXSXP ? sizeof(Rcomplex) : d->type==REALSXP ? sizeof(double) : sizeof(int);
+      if ((uint64_t)d->length*width != d->nbytes) readFail(_("its directory is inconsistent"));
+      SEXP col = allocVector(d->type, d->length);
+      SET_VECTOR_ELT(cols, i, col);
+      readAt(DATAPTR(col), d->offset, d->nbytes);
+    } break;
+    case STRSXP: {
+      const uint64_t dictBytes = (uint64_t)d->length*sizeof(int32_t) + ((uint64_t)d->nuniq+1)*sizeof(uint64_t) + d->nuniq;
+      if (d->nuniq<0 || d->length>INT_MAX || dictBytes > d->nbytes) readFail(_("its directory is inconsistent"));
+      char *buf = R_alloc(d->nbytes+1, 1);  // R_alloc is released when .Call returns, including on error
+      readAt(buf, d->offset, d->nbytes);
+      const int32_t *codes = (const int32_t *)buf;
+      uint64_t offsets[1];  // the offsets are not necessarily 8 byte aligned in buf after the codes, so are memcpy'd
+      const char *offp = buf + d->length*sizeof(int32_t);
+      const uint8_t *enc = (const uint8_t *)(offp + ((uint64_t)d->nuniq+1)*sizeof(uint64_t));
+      const char *chars = (const char *)enc + d->nuniq;
+      const uint64_t charBytes = d->nbytes - dictBytes;
+      SEXP col = allocVector(STRSXP, d->length);
+      SET_VECTOR_ELT(cols, i, col);
+      SEXP uniq = PROTECT(allocVector(STRSXP, d->nuniq));
+      uint64_t from = 0;
+      for (int k=0; k<d->nuniq; k++) {
+        memcpy(offsets, offp+(k+1)*sizeof(uint64_t), sizeof(uint64_t));
+        if (offsets[0]<from || offsets[0]>charBytes || offsets[0]-from > INT_MAX || enc[k]>CE_BYTES) {
+          UNPROTECT(1);
+          readFail(_("a character column's dictionary is inconsistent"));
+        }
+        SET_STRING_ELT(uniq, k, mkCharLenCE(chars+from, (int)(offsets[0]-from), (cetype_t)enc[k]));
+        from = offsets[0];
+      }
+      const SEXP *ud = STRING_PTR(uniq);
+      for (R_xlen_t r=0; r<d->length; r++) {
+        const int32_t c = codes[r];
+        if (c==NA_INTEGER) SET_STRING_ELT(col, r, NA_STRING);
+        else if (c>=0 && c<d->nuniq) SET_STRING_ELT(col, r, ud[c]);
+        else { UNPROTECT(1); readFail(_("a character column has a code outside its dictionary")); }
+      }
+      UNPROTECT(1);
+    } break;
+    default:
+      readFail(_("a column has an unknown type"));
+    }
+    if (verbose) Rprintf(_("Column %d of type '%s' loaded from %"PRIu64" bytes\n"), j+1, type2char(d->type), d->nbytes);
+  }
+  fclose(rf);
+  rf = NULL;
+  if (verbose) Rprintf(_("Loaded %d of %d columns and %"PRId64" rows in %.3fs\n"), nselect, ncol, foot.nrow, wallclock()-tt0);
+  UNPROTECT(1);
+  return ans;
+}
@@ -389,3 +389,11 @@ SEXP dt_zlib_version() {
 #endif
   return ScalarString(mkChar(out));
 }
+
+SEXP dt_has_zlib() {
+#ifndef NOZLIB
+  return ScalarLogical(TRUE);
+#else
+  return ScalarLogical(FALSE);
+#endif
+}